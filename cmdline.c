@@ -33,21 +33,39 @@ const char *gengetopt_args_info_versiontext = "";
 const char *gengetopt_args_info_description = "";
 
 const char *gengetopt_args_info_help[] = {
-  "  -h, --help                Print help and exit",
-  "  -V, --version             Print version and exit",
-  "  -i, --interface=STRING    interface  (possible values=\"udp\", \"serial\"\n                              default=`serial')",
-  "  -d, --dataset=STRING      Dataset file  (default=`./dataset.csv')",
-  "  -l, --listen-port=INT     Listen port  (default=`50000')",
-  "  -p, --send-port=INT       Send port  (default=`50005')",
-  "  -s, --serial-port=STRING  Serial port device  (default=`/dev/ttyACM0')",
-  "  -b, --baud-rate=INT       Baud rate  (possible values=\"9600\", \"115200\",\n                              \"230400\" default=`230400')",
-  "      --pause=INT           Pause before start  (default=`0')",
+  "  -h, --help                   Print help and exit",
+  "  -V, --version                Print version and exit",
+  "  -i, --interface=STRING       interface  (possible values=\"udp\", \"serial\"\n                                 default=`serial')",
+  "  -d, --dataset=STRING         Dataset file (CSV or binary)\n                                 (default=`./dataset.csv')",
+  "  -l, --listen-port=INT        Listen port  (default=`50000')",
+  "  -p, --send-port=INT          Send port  (default=`50005')",
+  "      --host=STRING            UDP device address[:port] (IPv6 as\n                                 [address]:port); several comma separated - the\n                                 upload runs on all of them at once\n                                 (default=`127.0.0.1')",
+  "      --shard                  With several devices: hand rows out to whichever\n                                 device is free instead of sending all rows to\n                                 each, results are printed in row order\n                                 (default=off)",
+  "  -s, --serial-port=STRING     Serial port device; several comma separated -\n                                 the upload runs on all of them at once\n                                 (default=`/dev/ttyACM0')",
+  "  -b, --baud-rate=INT          Baud rate, any integer rate the port supports\n                                 (e.g. 921600, 2000000)  (default=`230400')",
+  "      --flow-control           RTS/CTS hardware flow control  (default=off)",
+  "      --pause=INT              Pause before start  (default=`0')",
+  "      --read-ahead=INT         Samples parsed ahead in background thread (0 -\n                                 off)  (default=`256')",
+  "      --parse-threads=INT      CSV parser threads (0 - one per CPU core)\n                                 (default=`1')",
+  "      --convert=FILENAME       Convert dataset to binary file and exit",
+  "      --packet-cache=FILENAME  Send samples from pre-encoded packet cache file\n                                 (built when missing or stale)",
+  "      --start-row=LONG         First dataset row to send (0 - first row after\n                                 CSV header)  (default=`0')",
+  "      --end-row=LONG           Dataset row to stop before (0 - up to the end)\n                                 (default=`0')",
+  "      --window=INT             Samples in flight, negotiated with the device (1\n                                 - stop-and-wait)  (default=`1')",
+  "      --batch=INT              Samples per packet, limited by device buffer (0\n                                 - as many as fit, 1 - one sample per packet)\n                                 (default=`1')",
+  "      --max-retries=INT        Retransmissions of a request before giving up\n                                 (default=`3')",
+  "      --rto-min=INT            Minimum answer timeout of pipelined samples, ms\n                                 (adapts to measured answer time; stop-and-wait\n                                 requests wait at least 2000 ms)\n                                 (default=`20')",
+  "      --rto-max=INT            Maximum answer timeout, ms  (default=`10000')",
+  "      --progress=INT           Status line with rates, link use and ETA every N\n                                 seconds on stderr (0 - off)  (default=`0')",
+  "      --trace=FILENAME         Record a timeline of parsing, packet building,\n                                 writes, device waits and state transitions,\n                                 written at exit in Chrome trace format\n                                 (chrome://tracing, Perfetto)",
     0
 };
 
 typedef enum {ARG_NO
+  , ARG_FLAG
   , ARG_STRING
   , ARG_INT
+  , ARG_LONG
 } cmdline_parser_arg_type;
 
 static
@@ -61,7 +79,6 @@ cmdline_parser_internal (int argc, char **argv, struct gengetopt_args_info *args
 
 
 const char *cmdline_parser_interface_values[] = {"udp", "serial", 0}; /*< Possible values for interface. */
-const char *cmdline_parser_baud_rate_values[] = {"9600", "115200", "230400", 0}; /*< Possible values for baud-rate. */
 
 static char *
 gengetopt_strdup (const char *s);
@@ -75,9 +92,25 @@ void clear_given (struct gengetopt_args_info *args_info)
   args_info->dataset_given = 0 ;
   args_info->listen_port_given = 0 ;
   args_info->send_port_given = 0 ;
+  args_info->host_given = 0 ;
+  args_info->shard_given = 0 ;
   args_info->serial_port_given = 0 ;
   args_info->baud_rate_given = 0 ;
+  args_info->flow_control_given = 0 ;
   args_info->pause_given = 0 ;
+  args_info->read_ahead_given = 0 ;
+  args_info->parse_threads_given = 0 ;
+  args_info->convert_given = 0 ;
+  args_info->packet_cache_given = 0 ;
+  args_info->start_row_given = 0 ;
+  args_info->end_row_given = 0 ;
+  args_info->window_given = 0 ;
+  args_info->batch_given = 0 ;
+  args_info->max_retries_given = 0 ;
+  args_info->rto_min_given = 0 ;
+  args_info->rto_max_given = 0 ;
+  args_info->progress_given = 0 ;
+  args_info->trace_given = 0 ;
 }
 
 static
@@ -92,12 +125,42 @@ void clear_args (struct gengetopt_args_info *args_info)
   args_info->listen_port_orig = NULL;
   args_info->send_port_arg = 50005;
   args_info->send_port_orig = NULL;
+  args_info->host_arg = gengetopt_strdup ("127.0.0.1");
+  args_info->host_orig = NULL;
+  args_info->shard_flag = 0;
   args_info->serial_port_arg = gengetopt_strdup ("/dev/ttyACM0");
   args_info->serial_port_orig = NULL;
   args_info->baud_rate_arg = 230400;
   args_info->baud_rate_orig = NULL;
+  args_info->flow_control_flag = 0;
   args_info->pause_arg = 0;
   args_info->pause_orig = NULL;
+  args_info->read_ahead_arg = 256;
+  args_info->read_ahead_orig = NULL;
+  args_info->parse_threads_arg = 1;
+  args_info->parse_threads_orig = NULL;
+  args_info->convert_arg = NULL;
+  args_info->convert_orig = NULL;
+  args_info->packet_cache_arg = NULL;
+  args_info->packet_cache_orig = NULL;
+  args_info->start_row_arg = 0;
+  args_info->start_row_orig = NULL;
+  args_info->end_row_arg = 0;
+  args_info->end_row_orig = NULL;
+  args_info->window_arg = 1;
+  args_info->window_orig = NULL;
+  args_info->batch_arg = 1;
+  args_info->batch_orig = NULL;
+  args_info->max_retries_arg = 3;
+  args_info->max_retries_orig = NULL;
+  args_info->rto_min_arg = 20;
+  args_info->rto_min_orig = NULL;
+  args_info->rto_max_arg = 10000;
+  args_info->rto_max_orig = NULL;
+  args_info->progress_arg = 0;
+  args_info->progress_orig = NULL;
+  args_info->trace_arg = NULL;
+  args_info->trace_orig = NULL;
   
 }
 
@@ -112,9 +175,25 @@ void init_args_info(struct gengetopt_args_info *args_info)
   args_info->dataset_help = gengetopt_args_info_help[3] ;
   args_info->listen_port_help = gengetopt_args_info_help[4] ;
   args_info->send_port_help = gengetopt_args_info_help[5] ;
-  args_info->serial_port_help = gengetopt_args_info_help[6] ;
-  args_info->baud_rate_help = gengetopt_args_info_help[7] ;
-  args_info->pause_help = gengetopt_args_info_help[8] ;
+  args_info->host_help = gengetopt_args_info_help[6] ;
+  args_info->shard_help = gengetopt_args_info_help[7] ;
+  args_info->serial_port_help = gengetopt_args_info_help[8] ;
+  args_info->baud_rate_help = gengetopt_args_info_help[9] ;
+  args_info->flow_control_help = gengetopt_args_info_help[10] ;
+  args_info->pause_help = gengetopt_args_info_help[11] ;
+  args_info->read_ahead_help = gengetopt_args_info_help[12] ;
+  args_info->parse_threads_help = gengetopt_args_info_help[13] ;
+  args_info->convert_help = gengetopt_args_info_help[14] ;
+  args_info->packet_cache_help = gengetopt_args_info_help[15] ;
+  args_info->start_row_help = gengetopt_args_info_help[16] ;
+  args_info->end_row_help = gengetopt_args_info_help[17] ;
+  args_info->window_help = gengetopt_args_info_help[18] ;
+  args_info->batch_help = gengetopt_args_info_help[19] ;
+  args_info->max_retries_help = gengetopt_args_info_help[20] ;
+  args_info->rto_min_help = gengetopt_args_info_help[21] ;
+  args_info->rto_max_help = gengetopt_args_info_help[22] ;
+  args_info->progress_help = gengetopt_args_info_help[23] ;
+  args_info->trace_help = gengetopt_args_info_help[24] ;
   
 }
 
@@ -210,10 +289,28 @@ cmdline_parser_release (struct gengetopt_args_info *args_info)
   free_string_field (&(args_info->dataset_orig));
   free_string_field (&(args_info->listen_port_orig));
   free_string_field (&(args_info->send_port_orig));
+  free_string_field (&(args_info->host_arg));
+  free_string_field (&(args_info->host_orig));
   free_string_field (&(args_info->serial_port_arg));
   free_string_field (&(args_info->serial_port_orig));
   free_string_field (&(args_info->baud_rate_orig));
   free_string_field (&(args_info->pause_orig));
+  free_string_field (&(args_info->read_ahead_orig));
+  free_string_field (&(args_info->parse_threads_orig));
+  free_string_field (&(args_info->convert_arg));
+  free_string_field (&(args_info->convert_orig));
+  free_string_field (&(args_info->packet_cache_arg));
+  free_string_field (&(args_info->packet_cache_orig));
+  free_string_field (&(args_info->start_row_orig));
+  free_string_field (&(args_info->end_row_orig));
+  free_string_field (&(args_info->window_orig));
+  free_string_field (&(args_info->batch_orig));
+  free_string_field (&(args_info->max_retries_orig));
+  free_string_field (&(args_info->rto_min_orig));
+  free_string_field (&(args_info->rto_max_orig));
+  free_string_field (&(args_info->progress_orig));
+  free_string_field (&(args_info->trace_arg));
+  free_string_field (&(args_info->trace_orig));
   
   
 
@@ -297,12 +394,44 @@ cmdline_parser_dump(FILE *outfile, struct gengetopt_args_info *args_info)
     write_into_file(outfile, "listen-port", args_info->listen_port_orig, 0);
   if (args_info->send_port_given)
     write_into_file(outfile, "send-port", args_info->send_port_orig, 0);
+  if (args_info->host_given)
+    write_into_file(outfile, "host", args_info->host_orig, 0);
+  if (args_info->shard_given)
+    write_into_file(outfile, "shard", 0, 0 );
   if (args_info->serial_port_given)
     write_into_file(outfile, "serial-port", args_info->serial_port_orig, 0);
   if (args_info->baud_rate_given)
-    write_into_file(outfile, "baud-rate", args_info->baud_rate_orig, cmdline_parser_baud_rate_values);
+    write_into_file(outfile, "baud-rate", args_info->baud_rate_orig, 0);
+  if (args_info->flow_control_given)
+    write_into_file(outfile, "flow-control", 0, 0 );
   if (args_info->pause_given)
     write_into_file(outfile, "pause", args_info->pause_orig, 0);
+  if (args_info->read_ahead_given)
+    write_into_file(outfile, "read-ahead", args_info->read_ahead_orig, 0);
+  if (args_info->parse_threads_given)
+    write_into_file(outfile, "parse-threads", args_info->parse_threads_orig, 0);
+  if (args_info->convert_given)
+    write_into_file(outfile, "convert", args_info->convert_orig, 0);
+  if (args_info->packet_cache_given)
+    write_into_file(outfile, "packet-cache", args_info->packet_cache_orig, 0);
+  if (args_info->start_row_given)
+    write_into_file(outfile, "start-row", args_info->start_row_orig, 0);
+  if (args_info->end_row_given)
+    write_into_file(outfile, "end-row", args_info->end_row_orig, 0);
+  if (args_info->window_given)
+    write_into_file(outfile, "window", args_info->window_orig, 0);
+  if (args_info->batch_given)
+    write_into_file(outfile, "batch", args_info->batch_orig, 0);
+  if (args_info->max_retries_given)
+    write_into_file(outfile, "max-retries", args_info->max_retries_orig, 0);
+  if (args_info->rto_min_given)
+    write_into_file(outfile, "rto-min", args_info->rto_min_orig, 0);
+  if (args_info->rto_max_given)
+    write_into_file(outfile, "rto-max", args_info->rto_max_orig, 0);
+  if (args_info->progress_given)
+    write_into_file(outfile, "progress", args_info->progress_orig, 0);
+  if (args_info->trace_given)
+    write_into_file(outfile, "trace", args_info->trace_orig, 0);
   
 
   i = EXIT_SUCCESS;
@@ -1072,9 +1201,15 @@ int update_arg(void *field, char **orig_field,
     val = possible_values[found];
 
   switch(arg_type) {
+  case ARG_FLAG:
+    *((int *)field) = !*((int *)field);
+    break;
   case ARG_INT:
     if (val) *((int *)field) = strtol (val, &stop_char, 0);
     break;
+  case ARG_LONG:
+    if (val) *((long *)field) = (long)strtol (val, &stop_char, 0);
+    break;
   case ARG_STRING:
     if (val) {
       string_field = (char **)field;
@@ -1090,6 +1225,7 @@ int update_arg(void *field, char **orig_field,
   /* check numeric conversion */
   switch(arg_type) {
   case ARG_INT:
+  case ARG_LONG:
     if (val && !(stop_char && *stop_char == '\0')) {
       fprintf(stderr, "%s: invalid numeric value: %s\n", package_name, val);
       return 1; /* failure */
@@ -1102,6 +1238,7 @@ int update_arg(void *field, char **orig_field,
   /* store the original value */
   switch(arg_type) {
   case ARG_NO:
+  case ARG_FLAG:
     break;
   default:
     if (value && orig_field) {
@@ -1173,9 +1310,25 @@ cmdline_parser_internal (
         { "dataset",	1, NULL, 'd' },
         { "listen-port",	1, NULL, 'l' },
         { "send-port",	1, NULL, 'p' },
+        { "host",	1, NULL, 0 },
+        { "shard",	0, NULL, 0 },
         { "serial-port",	1, NULL, 's' },
         { "baud-rate",	1, NULL, 'b' },
+        { "flow-control",	0, NULL, 0 },
         { "pause",	1, NULL, 0 },
+        { "read-ahead",	1, NULL, 0 },
+        { "parse-threads",	1, NULL, 0 },
+        { "convert",	1, NULL, 0 },
+        { "packet-cache",	1, NULL, 0 },
+        { "start-row",	1, NULL, 0 },
+        { "end-row",	1, NULL, 0 },
+        { "window",	1, NULL, 0 },
+        { "batch",	1, NULL, 0 },
+        { "max-retries",	1, NULL, 0 },
+        { "rto-min",	1, NULL, 0 },
+        { "rto-max",	1, NULL, 0 },
+        { "progress",	1, NULL, 0 },
+        { "trace",	1, NULL, 0 },
         { 0,  0, 0, 0 }
       };
 
@@ -1217,7 +1370,7 @@ cmdline_parser_internal (
             goto failure;
         
           break;
-        case 'd':	/* Dataset file.  */
+        case 'd':	/* Dataset file (CSV or binary).  */
         
         
           if (update_arg( (void *)&(args_info->dataset_arg), 
@@ -1253,7 +1406,7 @@ cmdline_parser_internal (
             goto failure;
         
           break;
-        case 's':	/* Serial port device.  */
+        case 's':	/* Serial port device; several comma separated - the upload runs on all of them at once.  */
         
         
           if (update_arg( (void *)&(args_info->serial_port_arg), 
@@ -1265,12 +1418,12 @@ cmdline_parser_internal (
             goto failure;
         
           break;
-        case 'b':	/* Baud rate.  */
+        case 'b':	/* Baud rate, any integer rate the port supports (e.g. 921600, 2000000).  */
         
         
           if (update_arg( (void *)&(args_info->baud_rate_arg), 
                &(args_info->baud_rate_orig), &(args_info->baud_rate_given),
-              &(local_args_info.baud_rate_given), optarg, cmdline_parser_baud_rate_values, "230400", ARG_INT,
+              &(local_args_info.baud_rate_given), optarg, 0, "230400", ARG_INT,
               check_ambiguity, override, 0, 0,
               "baud-rate", 'b',
               additional_error))
@@ -1279,8 +1432,46 @@ cmdline_parser_internal (
           break;
 
         case 0:	/* Long option with no short option */
+          /* UDP device address[:port] (IPv6 as [address]:port); several comma separated - the upload runs on all of them at once.  */
+          if (strcmp (long_options[option_index].name, "host") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->host_arg), 
+                 &(args_info->host_orig), &(args_info->host_given),
+                &(local_args_info.host_given), optarg, 0, "127.0.0.1", ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "host", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* With several devices: hand rows out to whichever device is free instead of sending all rows to each, results are printed in row order.  */
+          else if (strcmp (long_options[option_index].name, "shard") == 0)
+          {
+          
+          
+            if (update_arg((void *)&(args_info->shard_flag), 0, &(args_info->shard_given),
+                &(local_args_info.shard_given), optarg, 0, 0, ARG_FLAG,
+                check_ambiguity, override, 1, 0, "shard", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* RTS/CTS hardware flow control.  */
+          else if (strcmp (long_options[option_index].name, "flow-control") == 0)
+          {
+          
+          
+            if (update_arg((void *)&(args_info->flow_control_flag), 0, &(args_info->flow_control_given),
+                &(local_args_info.flow_control_given), optarg, 0, 0, ARG_FLAG,
+                check_ambiguity, override, 1, 0, "flow-control", '-',
+                additional_error))
+              goto failure;
+          
+          }
           /* Pause before start.  */
-          if (strcmp (long_options[option_index].name, "pause") == 0)
+          else if (strcmp (long_options[option_index].name, "pause") == 0)
           {
           
           
@@ -1292,6 +1483,188 @@ cmdline_parser_internal (
                 additional_error))
               goto failure;
           
+          }
+          /* Samples parsed ahead in background thread (0 - off).  */
+          else if (strcmp (long_options[option_index].name, "read-ahead") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->read_ahead_arg), 
+                 &(args_info->read_ahead_orig), &(args_info->read_ahead_given),
+                &(local_args_info.read_ahead_given), optarg, 0, "256", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "read-ahead", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* CSV parser threads (0 - one per CPU core).  */
+          else if (strcmp (long_options[option_index].name, "parse-threads") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->parse_threads_arg), 
+                 &(args_info->parse_threads_orig), &(args_info->parse_threads_given),
+                &(local_args_info.parse_threads_given), optarg, 0, "1", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "parse-threads", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Convert dataset to binary file and exit.  */
+          else if (strcmp (long_options[option_index].name, "convert") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->convert_arg), 
+                 &(args_info->convert_orig), &(args_info->convert_given),
+                &(local_args_info.convert_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "convert", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Send samples from pre-encoded packet cache file (built when missing or stale).  */
+          else if (strcmp (long_options[option_index].name, "packet-cache") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->packet_cache_arg), 
+                 &(args_info->packet_cache_orig), &(args_info->packet_cache_given),
+                &(local_args_info.packet_cache_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "packet-cache", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* First dataset row to send (0 - first row after CSV header).  */
+          else if (strcmp (long_options[option_index].name, "start-row") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->start_row_arg), 
+                 &(args_info->start_row_orig), &(args_info->start_row_given),
+                &(local_args_info.start_row_given), optarg, 0, "0", ARG_LONG,
+                check_ambiguity, override, 0, 0,
+                "start-row", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Dataset row to stop before (0 - up to the end).  */
+          else if (strcmp (long_options[option_index].name, "end-row") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->end_row_arg), 
+                 &(args_info->end_row_orig), &(args_info->end_row_given),
+                &(local_args_info.end_row_given), optarg, 0, "0", ARG_LONG,
+                check_ambiguity, override, 0, 0,
+                "end-row", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Samples in flight, negotiated with the device (1 - stop-and-wait).  */
+          else if (strcmp (long_options[option_index].name, "window") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->window_arg), 
+                 &(args_info->window_orig), &(args_info->window_given),
+                &(local_args_info.window_given), optarg, 0, "1", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "window", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Samples per packet, limited by device buffer (0 - as many as fit, 1 - one sample per packet).  */
+          else if (strcmp (long_options[option_index].name, "batch") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->batch_arg), 
+                 &(args_info->batch_orig), &(args_info->batch_given),
+                &(local_args_info.batch_given), optarg, 0, "1", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "batch", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Retransmissions of a request before giving up.  */
+          else if (strcmp (long_options[option_index].name, "max-retries") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->max_retries_arg), 
+                 &(args_info->max_retries_orig), &(args_info->max_retries_given),
+                &(local_args_info.max_retries_given), optarg, 0, "3", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "max-retries", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Minimum answer timeout of pipelined samples, ms (adapts to measured answer time; stop-and-wait requests wait at least 2000 ms).  */
+          else if (strcmp (long_options[option_index].name, "rto-min") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->rto_min_arg), 
+                 &(args_info->rto_min_orig), &(args_info->rto_min_given),
+                &(local_args_info.rto_min_given), optarg, 0, "20", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "rto-min", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Maximum answer timeout, ms.  */
+          else if (strcmp (long_options[option_index].name, "rto-max") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->rto_max_arg), 
+                 &(args_info->rto_max_orig), &(args_info->rto_max_given),
+                &(local_args_info.rto_max_given), optarg, 0, "10000", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "rto-max", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Status line with rates, link use and ETA every N seconds on stderr (0 - off).  */
+          else if (strcmp (long_options[option_index].name, "progress") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->progress_arg), 
+                 &(args_info->progress_orig), &(args_info->progress_given),
+                &(local_args_info.progress_given), optarg, 0, "0", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "progress", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Record a timeline of parsing, packet building, writes, device waits and state transitions, written at exit in Chrome trace format (chrome://tracing, Perfetto).  */
+          else if (strcmp (long_options[option_index].name, "trace") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->trace_arg), 
+                 &(args_info->trace_orig), &(args_info->trace_given),
+                &(local_args_info.trace_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "trace", '-',
+                additional_error))
+              goto failure;
+          
           }
           
           break;
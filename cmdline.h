@@ -42,24 +42,70 @@ struct gengetopt_args_info
   char * interface_arg;	/**< @brief interface (default='serial').  */
   char * interface_orig;	/**< @brief interface original value given at command line.  */
   const char *interface_help; /**< @brief interface help description.  */
-  char * dataset_arg;	/**< @brief Dataset file (default='./dataset.csv').  */
-  char * dataset_orig;	/**< @brief Dataset file original value given at command line.  */
-  const char *dataset_help; /**< @brief Dataset file help description.  */
+  char * dataset_arg;	/**< @brief Dataset file (CSV or binary) (default='./dataset.csv').  */
+  char * dataset_orig;	/**< @brief Dataset file (CSV or binary) original value given at command line.  */
+  const char *dataset_help; /**< @brief Dataset file (CSV or binary) help description.  */
   int listen_port_arg;	/**< @brief Listen port (default='50000').  */
   char * listen_port_orig;	/**< @brief Listen port original value given at command line.  */
   const char *listen_port_help; /**< @brief Listen port help description.  */
   int send_port_arg;	/**< @brief Send port (default='50005').  */
   char * send_port_orig;	/**< @brief Send port original value given at command line.  */
   const char *send_port_help; /**< @brief Send port help description.  */
-  char * serial_port_arg;	/**< @brief Serial port device (default='/dev/ttyACM0').  */
-  char * serial_port_orig;	/**< @brief Serial port device original value given at command line.  */
-  const char *serial_port_help; /**< @brief Serial port device help description.  */
-  int baud_rate_arg;	/**< @brief Baud rate (default='230400').  */
-  char * baud_rate_orig;	/**< @brief Baud rate original value given at command line.  */
-  const char *baud_rate_help; /**< @brief Baud rate help description.  */
+  char * host_arg;	/**< @brief UDP device address[:port] (IPv6 as [address]:port); several comma separated - the upload runs on all of them at once (default='127.0.0.1').  */
+  char * host_orig;	/**< @brief UDP device address[:port] (IPv6 as [address]:port); several comma separated - the upload runs on all of them at once original value given at command line.  */
+  const char *host_help; /**< @brief UDP device address[:port] (IPv6 as [address]:port); several comma separated - the upload runs on all of them at once help description.  */
+  int shard_flag;	/**< @brief With several devices: hand rows out to whichever device is free instead of sending all rows to each, results are printed in row order (default=off).  */
+  const char *shard_help; /**< @brief With several devices: hand rows out to whichever device is free instead of sending all rows to each, results are printed in row order help description.  */
+  char * serial_port_arg;	/**< @brief Serial port device; several comma separated - the upload runs on all of them at once (default='/dev/ttyACM0').  */
+  char * serial_port_orig;	/**< @brief Serial port device; several comma separated - the upload runs on all of them at once original value given at command line.  */
+  const char *serial_port_help; /**< @brief Serial port device; several comma separated - the upload runs on all of them at once help description.  */
+  int baud_rate_arg;	/**< @brief Baud rate, any integer rate the port supports (e.g. 921600, 2000000) (default='230400').  */
+  char * baud_rate_orig;	/**< @brief Baud rate, any integer rate the port supports (e.g. 921600, 2000000) original value given at command line.  */
+  const char *baud_rate_help; /**< @brief Baud rate, any integer rate the port supports (e.g. 921600, 2000000) help description.  */
+  int flow_control_flag;	/**< @brief RTS/CTS hardware flow control (default=off).  */
+  const char *flow_control_help; /**< @brief RTS/CTS hardware flow control help description.  */
   int pause_arg;	/**< @brief Pause before start (default='0').  */
   char * pause_orig;	/**< @brief Pause before start original value given at command line.  */
   const char *pause_help; /**< @brief Pause before start help description.  */
+  int read_ahead_arg;	/**< @brief Samples parsed ahead in background thread (0 - off) (default='256').  */
+  char * read_ahead_orig;	/**< @brief Samples parsed ahead in background thread (0 - off) original value given at command line.  */
+  const char *read_ahead_help; /**< @brief Samples parsed ahead in background thread (0 - off) help description.  */
+  int parse_threads_arg;	/**< @brief CSV parser threads (0 - one per CPU core) (default='1').  */
+  char * parse_threads_orig;	/**< @brief CSV parser threads (0 - one per CPU core) original value given at command line.  */
+  const char *parse_threads_help; /**< @brief CSV parser threads (0 - one per CPU core) help description.  */
+  char * convert_arg;	/**< @brief Convert dataset to binary file and exit.  */
+  char * convert_orig;	/**< @brief Convert dataset to binary file and exit original value given at command line.  */
+  const char *convert_help; /**< @brief Convert dataset to binary file and exit help description.  */
+  char * packet_cache_arg;	/**< @brief Send samples from pre-encoded packet cache file (built when missing or stale).  */
+  char * packet_cache_orig;	/**< @brief Send samples from pre-encoded packet cache file (built when missing or stale) original value given at command line.  */
+  const char *packet_cache_help; /**< @brief Send samples from pre-encoded packet cache file (built when missing or stale) help description.  */
+  long start_row_arg;	/**< @brief First dataset row to send (0 - first row after CSV header) (default='0').  */
+  char * start_row_orig;	/**< @brief First dataset row to send (0 - first row after CSV header) original value given at command line.  */
+  const char *start_row_help; /**< @brief First dataset row to send (0 - first row after CSV header) help description.  */
+  long end_row_arg;	/**< @brief Dataset row to stop before (0 - up to the end) (default='0').  */
+  char * end_row_orig;	/**< @brief Dataset row to stop before (0 - up to the end) original value given at command line.  */
+  const char *end_row_help; /**< @brief Dataset row to stop before (0 - up to the end) help description.  */
+  int window_arg;	/**< @brief Samples in flight, negotiated with the device (1 - stop-and-wait) (default='1').  */
+  char * window_orig;	/**< @brief Samples in flight, negotiated with the device (1 - stop-and-wait) original value given at command line.  */
+  const char *window_help; /**< @brief Samples in flight, negotiated with the device (1 - stop-and-wait) help description.  */
+  int batch_arg;	/**< @brief Samples per packet, limited by device buffer (0 - as many as fit, 1 - one sample per packet) (default='1').  */
+  char * batch_orig;	/**< @brief Samples per packet, limited by device buffer (0 - as many as fit, 1 - one sample per packet) original value given at command line.  */
+  const char *batch_help; /**< @brief Samples per packet, limited by device buffer (0 - as many as fit, 1 - one sample per packet) help description.  */
+  int max_retries_arg;	/**< @brief Retransmissions of a request before giving up (default='3').  */
+  char * max_retries_orig;	/**< @brief Retransmissions of a request before giving up original value given at command line.  */
+  const char *max_retries_help; /**< @brief Retransmissions of a request before giving up help description.  */
+  int rto_min_arg;	/**< @brief Minimum answer timeout of pipelined samples, ms (adapts to measured answer time; stop-and-wait requests wait at least 2000 ms) (default='20').  */
+  char * rto_min_orig;	/**< @brief Minimum answer timeout of pipelined samples, ms (adapts to measured answer time; stop-and-wait requests wait at least 2000 ms) original value given at command line.  */
+  const char *rto_min_help; /**< @brief Minimum answer timeout of pipelined samples, ms (adapts to measured answer time; stop-and-wait requests wait at least 2000 ms) help description.  */
+  int rto_max_arg;	/**< @brief Maximum answer timeout, ms (default='10000').  */
+  char * rto_max_orig;	/**< @brief Maximum answer timeout, ms original value given at command line.  */
+  const char *rto_max_help; /**< @brief Maximum answer timeout, ms help description.  */
+  int progress_arg;	/**< @brief Status line with rates, link use and ETA every N seconds on stderr (0 - off) (default='0').  */
+  char * progress_orig;	/**< @brief Status line with rates, link use and ETA every N seconds on stderr (0 - off) original value given at command line.  */
+  const char *progress_help; /**< @brief Status line with rates, link use and ETA every N seconds on stderr (0 - off) help description.  */
+  char * trace_arg;	/**< @brief Record a timeline of parsing, packet building, writes, device waits and state transitions, written at exit in Chrome trace format (chrome://tracing, Perfetto).  */
+  char * trace_orig;	/**< @brief Record a timeline of parsing, packet building, writes, device waits and state transitions, written at exit in Chrome trace format (chrome://tracing, Perfetto) original value given at command line.  */
+  const char *trace_help; /**< @brief Record a timeline of parsing, packet building, writes, device waits and state transitions, written at exit in Chrome trace format (chrome://tracing, Perfetto) help description.  */
   
   unsigned int help_given ;	/**< @brief Whether help was given.  */
   unsigned int version_given ;	/**< @brief Whether version was given.  */
@@ -67,9 +113,25 @@ struct gengetopt_args_info
   unsigned int dataset_given ;	/**< @brief Whether dataset was given.  */
   unsigned int listen_port_given ;	/**< @brief Whether listen-port was given.  */
   unsigned int send_port_given ;	/**< @brief Whether send-port was given.  */
+  unsigned int host_given ;	/**< @brief Whether host was given.  */
+  unsigned int shard_given ;	/**< @brief Whether shard was given.  */
   unsigned int serial_port_given ;	/**< @brief Whether serial-port was given.  */
   unsigned int baud_rate_given ;	/**< @brief Whether baud-rate was given.  */
+  unsigned int flow_control_given ;	/**< @brief Whether flow-control was given.  */
   unsigned int pause_given ;	/**< @brief Whether pause was given.  */
+  unsigned int read_ahead_given ;	/**< @brief Whether read-ahead was given.  */
+  unsigned int parse_threads_given ;	/**< @brief Whether parse-threads was given.  */
+  unsigned int convert_given ;	/**< @brief Whether convert was given.  */
+  unsigned int packet_cache_given ;	/**< @brief Whether packet-cache was given.  */
+  unsigned int start_row_given ;	/**< @brief Whether start-row was given.  */
+  unsigned int end_row_given ;	/**< @brief Whether end-row was given.  */
+  unsigned int window_given ;	/**< @brief Whether window was given.  */
+  unsigned int batch_given ;	/**< @brief Whether batch was given.  */
+  unsigned int max_retries_given ;	/**< @brief Whether max-retries was given.  */
+  unsigned int rto_min_given ;	/**< @brief Whether rto-min was given.  */
+  unsigned int rto_max_given ;	/**< @brief Whether rto-max was given.  */
+  unsigned int progress_given ;	/**< @brief Whether progress was given.  */
+  unsigned int trace_given ;	/**< @brief Whether trace was given.  */
 
 } ;
 
@@ -195,7 +257,6 @@ int cmdline_parser_required (struct gengetopt_args_info *args_info,
   const char *prog_name);
 
 extern const char *cmdline_parser_interface_values[];  /**< @brief Possible values for interface. */
-extern const char *cmdline_parser_baud_rate_values[];  /**< @brief Possible values for baud-rate. */
 
 
 #ifdef __cplusplus
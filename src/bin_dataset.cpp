@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "bin_dataset.h"
+
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_IS_BIG_ENDIAN 1
+#else
+#define HOST_IS_BIG_ENDIAN 0
+#endif
+
+
+// Converts values between host and file (little endian) byte order
+static inline void swap_byte_order(float* values, uint32_t count)
+{
+#if HOST_IS_BIG_ENDIAN
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t v;
+		memcpy(&v, &values[i], sizeof(v));
+		v = __builtin_bswap32(v);
+		memcpy(&values[i], &v, sizeof(v));
+	}
+#else
+	(void) values;
+	(void) count;
+#endif
+}
+
+
+BinDatasetReader::BinDatasetReader(const std::string& fileName)
+	: m_Data(NULL), m_Size(0), m_Rows(NULL), m_Row(0)
+{
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("BinDatasetReader: File open error - \"" + fileName + "\"");
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t) st.st_size < sizeof(BinDatasetHeader))
+	{
+		close(fd);
+		throw std::runtime_error("BinDatasetReader: Invalid file - \"" + fileName + "\"");
+	}
+
+	m_Size = st.st_size;
+
+	void* data = mmap(NULL, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		throw std::runtime_error("BinDatasetReader: File map error - \"" + fileName + "\"");
+
+	madvise(data, m_Size, MADV_SEQUENTIAL);
+	m_Data = (const uint8_t*) data;
+
+	memcpy(&m_Header, m_Data, sizeof(m_Header));
+
+	const BinDatasetHeader& h = m_Header;
+	const uint64_t rowSize = (uint64_t) h.columnsCount * sizeof(float);
+
+	if (h.magic != BIN_DATASET_MAGIC || h.version != BIN_DATASET_VERSION ||
+		h.dtype != BIN_DTYPE_FLOAT32 || h.byteOrder != BIN_LITTLE_ENDIAN ||
+		h.headerSize < sizeof(BinDatasetHeader) || h.headerSize > m_Size ||
+		(m_Size - h.headerSize) / (rowSize ? rowSize : 1) < h.rowsCount)
+	{
+		munmap((void*) m_Data, m_Size);
+		throw std::runtime_error("BinDatasetReader: Unsupported or corrupted file - \"" + fileName + "\"");
+	}
+
+	m_Rows = (const float*) (m_Data + h.headerSize);
+}
+
+
+BinDatasetReader::~BinDatasetReader()
+{
+	if (m_Data)
+		munmap((void*) m_Data, m_Size);
+}
+
+
+int BinDatasetReader::ReadRow(float* values)
+{
+	if (m_Row >= m_Header.rowsCount)
+		return 0;
+
+	memcpy(values, m_Rows + m_Row * m_Header.columnsCount, m_Header.columnsCount * sizeof(float));
+	swap_byte_order(values, m_Header.columnsCount);
+	m_Row++;
+
+	return 1;
+}
+
+
+// Rows are fixed size: no index needed
+void BinDatasetReader::Seek(uint64_t row)
+{
+	if (row > m_Header.rowsCount)
+		throw std::out_of_range("BinDatasetReader: row out of range");
+
+	m_Row = row;
+}
+
+
+uint8_t bin_dataset_probe(const char* fileName)
+{
+	FILE* f = fopen(fileName, "rb");
+	if (!f)
+		return 0;
+
+	uint32_t magic = 0;
+	size_t n = fread(&magic, sizeof(magic), 1, f);
+	fclose(f);
+
+	return n == 1 && magic == BIN_DATASET_MAGIC;
+}
+
+
+int bin_dataset_convert(DatasetReader* source, const char* fileName)
+{
+	const uint32_t columns = source->Columns();
+	if (!columns)
+	{
+		fprintf(stderr, "Nothing to convert: empty file\n");
+		return 1;
+	}
+
+	float* row = (float*) calloc(columns, sizeof(float));
+	if (!row)
+	{
+		fprintf(stderr, "Failed to alloc row buffer\n");
+		return 2;
+	}
+
+	// Written aside and renamed at the end, an interrupted conversion
+	// never leaves a truncated dataset under the final name
+	const std::string tmpName = std::string(fileName) + ".tmp";
+
+	FILE* f = fopen(tmpName.c_str(), "wb");
+	if (!f)
+	{
+		fprintf(stderr, "Failed to create %s\n", tmpName.c_str());
+		free(row);
+		return 3;
+	}
+
+	BinDatasetHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+
+	hdr.magic = BIN_DATASET_MAGIC;
+	hdr.version = BIN_DATASET_VERSION;
+	hdr.dtype = BIN_DTYPE_FLOAT32;
+	hdr.byteOrder = BIN_LITTLE_ENDIAN;
+	hdr.columnsCount = columns;
+	hdr.headerSize = sizeof(BinDatasetHeader);
+	hdr.sourceHash = source->Hash();
+
+	int res = fwrite(&hdr, sizeof(hdr), 1, f) == 1 ? 1 : -2;
+
+	while (res == 1 && (res = source->ReadRow(row)) == 1)
+	{
+		swap_byte_order(row, columns);
+
+		if (fwrite(row, sizeof(float), columns, f) != columns)
+			res = -2;
+		else
+			hdr.rowsCount++;
+	}
+
+	if (res == 0)
+	{
+		if (0 != fseek(f, 0, SEEK_SET) || fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+			res = -2;
+	}
+
+	if (0 != fclose(f) && res == 0)
+		res = -2;
+
+	free(row);
+
+	if (res == 0 && 0 != rename(tmpName.c_str(), fileName))
+		res = -2;
+
+	if (res != 0)
+	{
+		unlink(tmpName.c_str());
+
+		if (res == -1)
+		{
+			fprintf(stderr, "%s: malformed row #%llu\n", __func__, (unsigned long long) hdr.rowsCount + 1);
+			return 4;
+		}
+
+		fprintf(stderr, "Failed to write %s\n", fileName);
+		return 5;
+	}
+
+	fprintf(stderr, "Converted %llu rows, %u columns\n", (unsigned long long) hdr.rowsCount, columns);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef BIN_DATASET_H
+#define BIN_DATASET_H
+
+#include <stdint.h>
+#include <string>
+
+#include "dataset.h"
+
+
+//
+// Binary dataset file:
+// - header
+// - rows: columnsCount float32 values each, little endian, no padding
+//
+
+
+#define BIN_DATASET_MAGIC       (0x3153444Eu)   // "NDS1"
+#define BIN_DATASET_VERSION     (1)
+
+
+typedef enum
+{
+	BIN_DTYPE_FLOAT32 = 0,
+}
+BinDataType;
+
+
+typedef enum
+{
+	BIN_LITTLE_ENDIAN = 0,
+	BIN_BIG_ENDIAN,
+}
+BinByteOrder;
+
+
+typedef struct
+{
+	uint32_t magic;             // Must be equal BIN_DATASET_MAGIC
+	uint16_t version;           // Format version
+	uint8_t  dtype;             // Values type, BinDataType
+	uint8_t  byteOrder;         // Values byte order, BinByteOrder
+	uint32_t columnsCount;      // Values in row (without bias)
+	uint32_t headerSize;        // Offset of the first row
+	uint64_t rowsCount;         // Rows in file
+	uint64_t sourceHash;        // dataset_hash() of the source file
+}
+BinDatasetHeader;
+
+
+class BinDatasetReader : public DatasetReader
+{
+public:
+	BinDatasetReader(const std::string& fileName);
+	~BinDatasetReader();
+
+	uint32_t Columns() const
+	{
+		return m_Header.columnsCount;
+	}
+
+	int ReadRow(float* values);
+	void Seek(uint64_t row);
+
+	uint64_t Hash()
+	{
+		return m_Header.sourceHash;
+	}
+
+	uint64_t Rows()
+	{
+		return m_Header.rowsCount;
+	}
+
+private:
+	BinDatasetReader(const BinDatasetReader&);
+	BinDatasetReader& operator=(const BinDatasetReader&);
+
+	BinDatasetHeader m_Header;
+	const uint8_t*   m_Data;
+	size_t           m_Size;
+	const float*     m_Rows;
+	uint64_t         m_Row;
+};
+
+
+// Returns 1 if the file starts with BIN_DATASET_MAGIC
+uint8_t bin_dataset_probe(const char* fileName);
+
+// Writes all rows of `source` to binary dataset `fileName`
+int bin_dataset_convert(DatasetReader* source, const char* fileName);
+
+
+#endif // BIN_DATASET_H
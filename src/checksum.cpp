@@ -1,5 +1,13 @@
+#include <stddef.h>
+#include <string.h>
+
 #include "checksum.h"
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CRC16_X86
+#endif
+
 static const uint16_t crc_ccitt_tab[256] =
 {
 	0x0000,	0x1021,	0x2042,	0x3063,	0x4084,	0x50a5,	0x60c6,	0x70e7,
@@ -36,12 +44,234 @@ static const uint16_t crc_ccitt_tab[256] =
 	0x6e17,	0x7e36,	0x4e55,	0x5e74,	0x2e93,	0x3eb2,	0x0ed1,	0x1ef0
 };
 
-uint16_t crc16_table(uint8_t* btData, uint32_t wLen, uint16_t prev)
+//
+// Slice-by-16: crc_slice_tab[k][b] is the CRC of byte `b` followed by k
+// zero bytes, so 16 input bytes are folded with 16 independent lookups
+// instead of a 16 step dependency chain. Tables are derived from
+// crc_ccitt_tab at startup.
+//
+#define CRC_SLICES 16
+
+static uint16_t crc_slice_tab[CRC_SLICES][256];
+
+
+static int crc_slice_init()
 {
-	uint16_t wCRC = prev;
+	for (uint32_t b = 0; b < 256; b++)
+		crc_slice_tab[0][b] = crc_ccitt_tab[b];
 
-	for (uint16_t i = 0; i < wLen; i++)
-		wCRC = (wCRC << 8) ^ crc_ccitt_tab[(wCRC >> 8) ^ btData[i]];
+	for (uint32_t k = 1; k < CRC_SLICES; k++)
+		for (uint32_t b = 0; b < 256; b++)
+		{
+			const uint16_t prev = crc_slice_tab[k - 1][b];
+			crc_slice_tab[k][b] = (prev << 8) ^ crc_ccitt_tab[prev >> 8];
+		}
+
+	return 1;
+}
+
+static const int crc_slice_ready = crc_slice_init();
+
+
+//
+// Kernels take optional `dst`: when set, input is copied there on the way,
+// while it is already in registers/L1
+//
+static uint16_t crc16_slice(const uint8_t* p, uint32_t wLen, uint16_t wCRC, uint8_t* dst)
+{
+	const uint16_t (*t)[256] = crc_slice_tab;
+
+	for (; wLen >= 16; wLen -= 16, p += 16)
+	{
+		if (dst)
+		{
+			memcpy(dst, p, 16);
+			dst += 16;
+		}
+
+		wCRC = t[15][p[0] ^ (wCRC >> 8)] ^ t[14][p[1] ^ (wCRC & 0xff)] ^
+			   t[13][p[2]]  ^ t[12][p[3]]  ^ t[11][p[4]]  ^ t[10][p[5]]  ^
+			   t[9][p[6]]   ^ t[8][p[7]]   ^ t[7][p[8]]   ^ t[6][p[9]]   ^
+			   t[5][p[10]]  ^ t[4][p[11]]  ^ t[3][p[12]]  ^ t[2][p[13]]  ^
+			   t[1][p[14]]  ^ t[0][p[15]];
+	}
+
+	if (dst && wLen)
+		memcpy(dst, p, wLen);
+
+	if (wLen >= 8)
+	{
+		wCRC = t[7][p[0] ^ (wCRC >> 8)] ^ t[6][p[1] ^ (wCRC & 0xff)] ^
+			   t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^
+			   t[1][p[6]] ^ t[0][p[7]];
+
+		wLen -= 8;
+		p += 8;
+	}
+
+	for (; wLen; wLen--, p++)
+		wCRC = (wCRC << 8) ^ crc_ccitt_tab[(wCRC >> 8) ^ *p];
 
 	return wCRC;
 }
+
+
+#if defined(CRC16_X86)
+
+//
+// Folding with carry-less multiply: message bits are kept MSB first in
+// 128-bit lanes (bytes reversed on load), a lane D bits ahead of the
+// next one is folded into it as hi * (x^(D+64) mod P) ^ lo * (x^D mod P).
+// Four lanes are folded in parallel to hide multiply latency, then
+// merged, and the last 16 byte remainder goes through the tables.
+// Needs at least CRC_VECTOR_MIN bytes.
+//
+#define CRC_POLY            0x11021u
+
+typedef struct
+{
+	uint64_t fold4[2];          // x^576, x^512
+	uint64_t merge[3][2];       // x^448, x^384 / x^320, x^256 / x^192, x^128
+	uint64_t fold1[2];          // x^192, x^128
+}
+CrcFoldConstants;
+
+static CrcFoldConstants crc_fold;
+
+
+static uint64_t crc_xpow_mod(uint32_t n)
+{
+	uint32_t r = 1;
+
+	while (n--)
+	{
+		r <<= 1;
+		if (r & 0x10000)
+			r ^= CRC_POLY;
+	}
+
+	return r;
+}
+
+
+static void crc_fold_init()
+{
+	crc_fold.fold4[0] = crc_xpow_mod(576);
+	crc_fold.fold4[1] = crc_xpow_mod(512);
+
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		crc_fold.merge[i][0] = crc_xpow_mod(128 * (3 - i) + 64);
+		crc_fold.merge[i][1] = crc_xpow_mod(128 * (3 - i));
+	}
+
+	crc_fold.fold1[0] = crc_xpow_mod(192);
+	crc_fold.fold1[1] = crc_xpow_mod(128);
+}
+
+
+// Loads 16 bytes at src + offset (copying them to dst + offset when dst is set)
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i crc_load(const uint8_t* src, uint8_t* dst, uint32_t offset, __m128i swap)
+{
+	const __m128i v = _mm_loadu_si128((const __m128i*) (src + offset));
+
+	if (dst)
+		_mm_storeu_si128((__m128i*) (dst + offset), v);
+
+	return _mm_shuffle_epi8(v, swap);
+}
+
+
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i crc_fold_lane(__m128i a, const uint64_t* k, __m128i b)
+{
+	const __m128i kk = _mm_set_epi64x(k[0], k[1]);
+
+	return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(a, kk, 0x11),
+									   _mm_clmulepi64_si128(a, kk, 0x00)), b);
+}
+
+
+__attribute__((target("pclmul,ssse3")))
+static uint16_t crc16_clmul(const uint8_t* p, uint32_t wLen, uint16_t wCRC, uint8_t* dst)
+{
+	const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i zero = _mm_setzero_si128();
+
+	// Initial CRC value is xor-ed into the first two message bytes
+	__m128i a0 = _mm_xor_si128(crc_load(p, dst, 0, swap), _mm_set_epi16(wCRC, 0, 0, 0, 0, 0, 0, 0));
+	__m128i a1 = crc_load(p, dst, 16, swap);
+	__m128i a2 = crc_load(p, dst, 32, swap);
+	__m128i a3 = crc_load(p, dst, 48, swap);
+	uint32_t pos = 64;
+
+	for (; wLen - pos >= 64; pos += 64)
+	{
+		a0 = crc_fold_lane(a0, crc_fold.fold4, crc_load(p, dst, pos, swap));
+		a1 = crc_fold_lane(a1, crc_fold.fold4, crc_load(p, dst, pos + 16, swap));
+		a2 = crc_fold_lane(a2, crc_fold.fold4, crc_load(p, dst, pos + 32, swap));
+		a3 = crc_fold_lane(a3, crc_fold.fold4, crc_load(p, dst, pos + 48, swap));
+	}
+
+	__m128i a = crc_fold_lane(a2, crc_fold.merge[2], a3);
+	a = _mm_xor_si128(a, crc_fold_lane(a1, crc_fold.merge[1], zero));
+	a = _mm_xor_si128(a, crc_fold_lane(a0, crc_fold.merge[0], zero));
+
+	for (; wLen - pos >= 16; pos += 16)
+		a = crc_fold_lane(a, crc_fold.fold1, crc_load(p, dst, pos, swap));
+
+	uint8_t rest[16];
+	_mm_storeu_si128((__m128i*) rest, _mm_shuffle_epi8(a, swap));
+
+	return crc16_slice(p + pos, wLen - pos, crc16_slice(rest, sizeof(rest), 0, NULL), dst ? dst + pos : NULL);
+}
+
+#endif // CRC16_X86
+
+
+// Shorter inputs are faster through the tables
+#define CRC_VECTOR_MIN 64
+
+typedef uint16_t (*crc16_fn)(const uint8_t* data, uint32_t len, uint16_t prev, uint8_t* dst);
+
+
+static crc16_fn crc16_select()
+{
+#if defined(CRC16_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+	{
+		crc_fold_init();
+		return crc16_clmul;
+	}
+#endif
+
+	return crc16_slice;
+}
+
+
+static uint16_t crc16_run(const uint8_t* data, uint32_t len, uint16_t prev, uint8_t* dst)
+{
+	static const crc16_fn impl = crc16_select();
+
+	(void) crc_slice_ready;
+
+	if (len < CRC_VECTOR_MIN)
+		return crc16_slice(data, len, prev, dst);
+
+	return impl(data, len, prev, dst);
+}
+
+
+uint16_t crc16_table(uint8_t* btData, uint32_t wLen, uint16_t prev)
+{
+	return crc16_run(btData, wLen, prev, NULL);
+}
+
+
+uint16_t crc16_copy(uint8_t* dst, const uint8_t* src, uint32_t wLen, uint16_t prev)
+{
+	return crc16_run(src, wLen, prev, dst);
+}
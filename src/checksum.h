@@ -5,4 +5,8 @@
 
 uint16_t crc16_table(uint8_t* btData, uint32_t wLen, uint16_t prev);
 
+// Copies wLen bytes from src to dst and returns their CRC (continuing
+// from `prev`), reading the source only once
+uint16_t crc16_copy(uint8_t* dst, const uint8_t* src, uint32_t wLen, uint16_t prev);
+
 #endif // CHECKSUM_H
@@ -0,0 +1,141 @@
+#include "csv_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_SCAN_X86
+#endif
+
+
+typedef size_t (*csv_scan_fn)(const char* data, size_t size, char delimiter,
+							  uint32_t* offsets, size_t capacity, size_t* scanned);
+
+
+//
+// Scalar scan of data[pos..size), used as fallback and for the vector tails
+//
+static inline size_t scan_scalar(const char* data, size_t pos, size_t size, char delimiter,
+								 uint32_t* offsets, size_t capacity, size_t count, size_t* scanned)
+{
+	while (pos < size && capacity - count >= CSV_SCAN_BLOCK)
+	{
+		const size_t blockEnd = size - pos > CSV_SCAN_BLOCK ? pos + CSV_SCAN_BLOCK : size;
+
+		for (; pos < blockEnd; pos++)
+			if (data[pos] == delimiter || data[pos] == '\n')
+				offsets[count++] = (uint32_t) pos;
+	}
+
+	*scanned = pos;
+	return count;
+}
+
+
+static size_t csv_scan_scalar(const char* data, size_t size, char delimiter,
+							  uint32_t* offsets, size_t capacity, size_t* scanned)
+{
+	return scan_scalar(data, 0, size, delimiter, offsets, capacity, 0, scanned);
+}
+
+
+#if defined(CSV_SCAN_X86)
+
+static inline size_t emit_offsets(uint64_t mask, size_t base, uint32_t* offsets, size_t count)
+{
+	while (mask)
+	{
+		offsets[count++] = (uint32_t) (base + __builtin_ctzll(mask));
+		mask &= mask - 1;
+	}
+
+	return count;
+}
+
+
+__attribute__((target("sse2")))
+static inline uint64_t block_mask_sse2(const char* block, char delimiter)
+{
+	const __m128i delim = _mm_set1_epi8(delimiter);
+	const __m128i eol = _mm_set1_epi8('\n');
+	uint64_t mask = 0;
+
+	for (int i = 0; i < CSV_SCAN_BLOCK; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*) (block + i));
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, delim), _mm_cmpeq_epi8(v, eol));
+		mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(m) << i;
+	}
+
+	return mask;
+}
+
+
+__attribute__((target("avx2")))
+static inline uint64_t block_mask_avx2(const char* block, char delimiter)
+{
+	const __m256i delim = _mm256_set1_epi8(delimiter);
+	const __m256i eol = _mm256_set1_epi8('\n');
+
+	__m256i lo = _mm256_loadu_si256((const __m256i*) block);
+	__m256i hi = _mm256_loadu_si256((const __m256i*) (block + 32));
+
+	__m256i mlo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, delim), _mm256_cmpeq_epi8(lo, eol));
+	__m256i mhi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, delim), _mm256_cmpeq_epi8(hi, eol));
+
+	return (uint64_t) (uint32_t) _mm256_movemask_epi8(mlo) |
+		   ((uint64_t) (uint32_t) _mm256_movemask_epi8(mhi) << 32);
+}
+
+
+__attribute__((target("sse2")))
+static size_t csv_scan_sse2(const char* data, size_t size, char delimiter,
+							uint32_t* offsets, size_t capacity, size_t* scanned)
+{
+	size_t count = 0;
+	size_t pos = 0;
+
+	for (; pos + CSV_SCAN_BLOCK <= size && capacity - count >= CSV_SCAN_BLOCK; pos += CSV_SCAN_BLOCK)
+		count = emit_offsets(block_mask_sse2(data + pos, delimiter), pos, offsets, count);
+
+	return scan_scalar(data, pos, size, delimiter, offsets, capacity, count, scanned);
+}
+
+
+__attribute__((target("avx2")))
+static size_t csv_scan_avx2(const char* data, size_t size, char delimiter,
+							uint32_t* offsets, size_t capacity, size_t* scanned)
+{
+	size_t count = 0;
+	size_t pos = 0;
+
+	for (; pos + CSV_SCAN_BLOCK <= size && capacity - count >= CSV_SCAN_BLOCK; pos += CSV_SCAN_BLOCK)
+		count = emit_offsets(block_mask_avx2(data + pos, delimiter), pos, offsets, count);
+
+	return scan_scalar(data, pos, size, delimiter, offsets, capacity, count, scanned);
+}
+
+#endif // CSV_SCAN_X86
+
+
+static csv_scan_fn csv_scan_select()
+{
+#if defined(CSV_SCAN_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return csv_scan_avx2;
+
+	if (__builtin_cpu_supports("sse2"))
+		return csv_scan_sse2;
+#endif
+
+	return csv_scan_scalar;
+}
+
+
+size_t csv_scan(const char* data, size_t size, char delimiter,
+				uint32_t* offsets, size_t capacity, size_t* scanned)
+{
+	static const csv_scan_fn impl = csv_scan_select();
+
+	return impl(data, size, delimiter, offsets, capacity, scanned);
+}
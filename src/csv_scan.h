@@ -0,0 +1,23 @@
+#ifndef CSV_SCAN_H
+#define CSV_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+//
+// Finds positions of `delimiter` and '\n' in data[0..size) and stores
+// their offsets (relative to data) in ascending order.
+// Scanning stops early when fewer than CSV_SCAN_BLOCK slots are left in
+// `offsets`, `*scanned` receives the number of bytes actually covered.
+// Returns number of offsets stored.
+//
+// Uses AVX2 or SSE2 when the CPU supports them, scalar code otherwise.
+//
+#define CSV_SCAN_BLOCK 64
+
+size_t csv_scan(const char* data, size_t size, char delimiter,
+				uint32_t* offsets, size_t capacity, size_t* scanned);
+
+
+#endif // CSV_SCAN_H
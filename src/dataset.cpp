@@ -0,0 +1,94 @@
+#include <string.h>
+
+#include "dataset.h"
+#include "bin_dataset.h"
+#include "parallel_csv.h"
+#include "row_index.h"
+
+#include <thread>
+
+
+#define HASH_OFFSET_BASIS   0xcbf29ce484222325ull
+#define HASH_PRIME          0x100000001b3ull
+
+
+CsvDatasetReader::CsvDatasetReader(const std::string& fileName)
+	: m_FileName(fileName), m_Reader(fileName), m_Columns(0), m_DataOffset(0)
+{
+	m_Columns = m_Reader.ReadLine(NULL, 0);
+	m_DataOffset = m_Reader.Position() - m_Reader.Data();
+}
+
+
+int CsvDatasetReader::ReadRow(float* values)
+{
+	size_t count = m_Reader.ReadLine(values, m_Columns);
+	if (count == 0)
+		return 0;
+
+	return count == m_Columns ? 1 : -1;
+}
+
+
+void CsvDatasetReader::Seek(uint64_t row)
+{
+	if (row == 0)
+	{
+		m_Reader.Seek(m_DataOffset);
+		return;
+	}
+
+	m_Reader.Seek(row_index_offset(m_FileName, m_Reader.Data(), m_Reader.Size(), m_DataOffset, row));
+}
+
+
+uint64_t CsvDatasetReader::Hash()
+{
+	return dataset_hash(m_Reader.Data(), m_Reader.Size());
+}
+
+
+uint64_t CsvDatasetReader::Rows()
+{
+	return row_index_rows(m_FileName, m_Reader.Data(), m_Reader.Size(), m_DataOffset);
+}
+
+
+DatasetReader* dataset_open(const std::string& fileName, uint32_t threads)
+{
+	if (bin_dataset_probe(fileName.c_str()))
+		return new BinDatasetReader(fileName);
+
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+
+	if (threads > 1)
+		return new ParallelCsvReader(fileName, threads);
+
+	return new CsvDatasetReader(fileName);
+}
+
+
+//
+// FNV-1a over 64-bit words (bytes for the tail) with an extra shift to
+// fold high bits down: not cryptographic, just fast enough to fingerprint
+// multi-GB files
+//
+uint64_t dataset_hash(const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*) data;
+	uint64_t hash = HASH_OFFSET_BASIS ^ size;
+
+	for (; size >= sizeof(uint64_t); p += sizeof(uint64_t), size -= sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		hash = (hash ^ word) * HASH_PRIME;
+		hash ^= hash >> 32;
+	}
+
+	for (; size; p++, size--)
+		hash = (hash ^ *p) * HASH_PRIME;
+
+	return hash;
+}
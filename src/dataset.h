@@ -0,0 +1,74 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "mmap_csv.h"
+
+
+//
+// Source of dataset rows, one row is `Columns()` float values
+// (bias column is not included)
+//
+class DatasetReader
+{
+public:
+	virtual ~DatasetReader() {}
+
+	virtual uint32_t Columns() const = 0;
+
+	// Reads next row into values[0..Columns()).
+	// Returns 1 - row read, 0 - end of dataset, -1 - malformed row
+	virtual int ReadRow(float* values) = 0;
+
+	// Positions reader at data row `row` (0 - first row).
+	// Throws std::exception when the row is out of range.
+	virtual void Seek(uint64_t row) = 0;
+
+	// Hash identifying dataset contents
+	virtual uint64_t Hash() = 0;
+
+	// Number of data rows. May take a pass over the file (CSV without a
+	// saved row index).
+	// Throws std::exception on failure.
+	virtual uint64_t Rows() = 0;
+};
+
+
+//
+// CSV dataset: first line is a header, the rest are numeric rows
+//
+class CsvDatasetReader : public DatasetReader
+{
+public:
+	CsvDatasetReader(const std::string& fileName);
+
+	uint32_t Columns() const
+	{
+		return m_Columns;
+	}
+
+	int ReadRow(float* values);
+	void Seek(uint64_t row);
+	uint64_t Hash();
+	uint64_t Rows();
+
+private:
+	std::string   m_FileName;
+	MmapCsvReader m_Reader;
+	uint32_t      m_Columns;
+	size_t        m_DataOffset;     // First data row
+};
+
+
+// Opens CSV or binary dataset, format is detected by magic number.
+// CSV is parsed by `threads` workers (0 - one per CPU core).
+// Throws std::exception on failure.
+DatasetReader* dataset_open(const std::string& fileName, uint32_t threads);
+
+uint64_t dataset_hash(const void* data, size_t size);
+
+
+#endif // DATASET_H
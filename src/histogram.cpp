@@ -0,0 +1,45 @@
+#include <math.h>
+
+#include "histogram.h"
+
+
+// Largest value counted in the bucket
+static uint64_t bucket_upper(uint32_t bucket)
+{
+	const uint64_t sub = 1ull << HISTOGRAM_SUB_BITS;
+
+	if (bucket < sub)
+		return bucket;
+
+	const uint32_t shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+	const uint64_t index = (bucket & (sub - 1)) + sub;
+
+	return ((index + 1) << shift) - 1;
+}
+
+
+uint64_t histogram_percentile(const Histogram* h, double percentile)
+{
+	if (!h->total)
+		return 0;
+
+	uint64_t rank = (uint64_t) ceil(percentile / 100.0 * h->total);
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->total)
+		rank = h->total;
+
+	uint64_t seen = 0;
+
+	for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += h->counts[i];
+		if (seen >= rank)
+		{
+			const uint64_t upper = bucket_upper(i);
+			return upper < h->max ? upper : h->max;
+		}
+	}
+
+	return h->max;
+}
@@ -0,0 +1,58 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+
+//
+// Log-bucketed histogram in the HDR style: values below 2^SUB_BITS get
+// a bucket each, above that every power of two is split into 2^SUB_BITS
+// linear buckets, so any value is known to within 1/32 (~3%). Counts
+// live in the structure, recording is a few instructions.
+//
+#define HISTOGRAM_SUB_BITS      (5)
+#define HISTOGRAM_MAX_BITS      (40)        // Larger values go to the last bucket
+#define HISTOGRAM_BUCKETS       ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+
+typedef struct
+{
+	uint64_t counts[HISTOGRAM_BUCKETS];
+	uint64_t total;
+	uint64_t max;
+}
+Histogram;
+
+
+static inline uint32_t histogram_bucket(uint64_t value)
+{
+	const uint64_t sub = 1ull << HISTOGRAM_SUB_BITS;
+
+	if (value < sub)
+		return (uint32_t) value;
+
+	if (value >= (1ull << HISTOGRAM_MAX_BITS))
+		return HISTOGRAM_BUCKETS - 1;
+
+	const uint32_t shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+
+	return ((shift + 1) << HISTOGRAM_SUB_BITS) + (uint32_t) ((value >> shift) - sub);
+}
+
+
+static inline void histogram_record(Histogram* h, uint64_t value, uint64_t count)
+{
+	h->counts[histogram_bucket(value)] += count;
+	h->total += count;
+
+	if (h->max < value)
+		h->max = value;
+}
+
+
+// Smallest value that `percentile` (0..100) percent of the recorded
+// values don't exceed, rounded up to its bucket's upper bound
+uint64_t histogram_percentile(const Histogram* h, double percentile);
+
+
+#endif // HISTOGRAM_H
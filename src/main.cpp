@@ -4,6 +4,30 @@
 
 #include "../cmdline.h"
 #include "sender.h"
+#include "shard.h"
+#include "bin_dataset.h"
+#include "trace.h"
+
+
+static int convert_dataset(const char* source, const char* destination, uint32_t threads)
+{
+	DatasetReader* reader;
+
+	try
+	{
+		reader = dataset_open(source, threads);
+	}
+	catch (std::exception& e)
+	{
+		fprintf(stderr, "Failed to open dataset: %s\n", e.what());
+		return 1;
+	}
+
+	int res = bin_dataset_convert(reader, destination);
+	delete reader;
+
+	return res;
+}
 
 
 int main(int argc, char** argv)
@@ -27,13 +51,53 @@ int main(int argc, char** argv)
 
 	int delay = ai.pause_arg;
 
-	int speed = ai.baud_rate_arg;
-	switch (speed)
+	if (ai.read_ahead_arg < 0)
+	{
+		fprintf(stderr, "Invalid read-ahead depth\n");
+		return 1;
+	}
+
+	if (ai.parse_threads_arg < 0)
 	{
-	case   9600:  speed = B9600;    break;
-	case 115200:  speed = B115200;  break;
-	case 230400:  speed = B230400;  break;
-	default: return 1;
+		fprintf(stderr, "Invalid parser threads count\n");
+		return 1;
+	}
+
+	if (ai.start_row_arg < 0 || ai.end_row_arg < 0 ||
+		(ai.end_row_arg && ai.end_row_arg <= ai.start_row_arg))
+	{
+		fprintf(stderr, "Invalid rows range\n");
+		return 1;
+	}
+
+	if (ai.window_arg < 1 || ai.window_arg > SENDER_MAX_WINDOW)
+	{
+		fprintf(stderr, "Invalid window size (1..%u)\n", SENDER_MAX_WINDOW);
+		return 1;
+	}
+
+	if (ai.batch_arg < 0 || ai.batch_arg > UINT16_MAX)
+	{
+		fprintf(stderr, "Invalid batch size\n");
+		return 1;
+	}
+
+	if (ai.max_retries_arg < 0 || ai.rto_min_arg < 1 || ai.rto_max_arg < ai.rto_min_arg)
+	{
+		fprintf(stderr, "Invalid retries count or answer timeout range\n");
+		return 1;
+	}
+
+	if (ai.baud_rate_arg <= 0)
+	{
+		fprintf(stderr, "Invalid baud rate\n");
+		return 1;
+	}
+
+	if (ai.progress_arg < 0)
+	{
+		fprintf(stderr, "Invalid progress interval\n");
+		return 1;
 	}
 
 	if (datasetFilename == NULL)
@@ -42,21 +106,187 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	Sender *sender = sender_create(interface == UDP, datasetFilename, bindPort, sendPort,
-									serialPort, speed);
-	if (!sender)
+	if (ai.convert_given)
+		return convert_dataset(datasetFilename, ai.convert_arg, ai.parse_threads_arg);
+
+	// Several devices, comma separated: each one runs the whole upload,
+	// or takes its share of rows
+	char* hosts = strdup(interface == UDP ? ai.host_arg : serialPort);
+	uint32_t devices = 1;
+
+	for (char* p = hosts; *p; p++)
+	{
+		if (*p == ',')
+		{
+			*p = '\0';
+			devices++;
+		}
+	}
+
+	SenderConfig config;
+	memset(&config, 0, sizeof(config));
+
+	config.isUdp = interface == UDP;
+	config.dataset = datasetFilename;
+	config.sendPort = sendPort;
+	config.baud = ai.baud_rate_arg;
+	config.flowControl = ai.flow_control_flag;
+	config.readAhead = ai.read_ahead_arg;
+	config.parseThreads = ai.parse_threads_arg;
+	config.packetCache = ai.packet_cache_arg;
+	config.startRow = ai.start_row_arg;
+	config.endRow = ai.end_row_arg;
+	config.window = ai.window_arg;
+	config.batch = ai.batch_arg;
+	config.maxRetries = ai.max_retries_arg;
+	config.rtoMin = ai.rto_min_arg;
+	config.rtoMax = ai.rto_max_arg;
+	config.progress = ai.progress_arg;
+
+	TraceLog* trace = NULL;
+	if (ai.trace_given && !(trace = config.trace = trace_log_create()))
 	{
-		fprintf(stderr, "Failed to create sender\n");
+		fprintf(stderr, "Failed to alloc trace\n");
+		free(hosts);
 		return 1;
 	}
 
-	int res = sender_run(sender, delay);
+	Shard* shard = NULL;
+	if (ai.shard_flag)
+	{
+		shard = shard_create(&config);
+		if (!shard)
+		{
+			trace_log_destroy(trace);
+			free(hosts);
+			return 1;
+		}
+
+		config.shard = shard;
+	}
+
+	Sender** senders = (Sender**) calloc(devices, sizeof(Sender*));
+	FILE** outputs = (FILE**) calloc(devices, sizeof(FILE*));
+	const char** names = (const char**) calloc(devices, sizeof(char*));
+	int res = 0;
+
+	if (!senders || !outputs || !names)
+	{
+		fprintf(stderr, "Failed to alloc senders\n");
+		res = 1;
+	}
+
+	// The first device prints results right away, the others after it
+	// in the order given, unless rows are shared. Each device answers
+	// on its own listen port.
+	const char* host = hosts;
+	for (uint32_t i = 0; i < devices && res == 0; i++, host += strlen(host) + 1)
+	{
+		names[i] = host;
+
+		if (i && !shard && !(outputs[i] = tmpfile()))
+		{
+			fprintf(stderr, "Failed to create results file\n");
+			res = 1;
+			break;
+		}
+
+		config.host = host;
+		config.serial = host;
+		config.bindPort = bindPort + i;
+		config.output = outputs[i];
+		config.device = i;
+
+		senders[i] = sender_create(&config);
+		if (!senders[i] || 0 != sender_start(senders[i], delay))
+		{
+			fprintf(stderr, "Failed to create sender\n");
+			res = 1;
+		}
+	}
+
+	if (res == 0)
+		res = uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+	uint64_t total = 0;
+	uint64_t startedAt = UINT64_MAX;
+	uint64_t finishedAt = 0;
+
+	for (uint32_t i = 0; senders && i < devices; i++)
+	{
+		Sender* sender = senders[i];
+		if (!sender)
+			continue;
+
+		if (res == 0 && sender->error)
+			res = sender->error;
+
+		if (devices > 1 && sender->finishedAt > sender->startedAt)
+		{
+			const double seconds = (sender->finishedAt - sender->startedAt) / 1e6;
 
-	if (sender->error)
-		res = sender->error;
+			fprintf(stderr, "Device %s: %llu samples in %.2f s, %.0f samples/s%s\n", names[i],
+					(unsigned long long) sender->samplesRead, seconds, sender->samplesRead / seconds,
+					sender->error ? ", failed" : "");
+
+			total += sender->samplesRead;
+			startedAt = startedAt < sender->startedAt ? startedAt : sender->startedAt;
+			finishedAt = finishedAt > sender->finishedAt ? finishedAt : sender->finishedAt;
+		}
+
+		sender_destroy(sender);
+		free(sender);
+	}
+
+	if (shard)
+	{
+		if (res == 0 && !shard_complete(shard))
+		{
+			fprintf(stderr, "Not all rows were answered, results are incomplete\n");
+			res = 1;
+		}
+
+		shard_destroy(shard);
+	}
+
+	// Background threads are joined by now
+	if (trace)
+	{
+		if (0 != trace_log_write(trace, ai.trace_arg) && res == 0)
+			res = 1;
+
+		trace_log_destroy(trace);
+	}
+
+	if (devices > 1 && finishedAt > startedAt)
+	{
+		const double seconds = (finishedAt - startedAt) / 1e6;
+
+		fprintf(stderr, "%u devices: %llu samples in %.2f s, %.0f samples/s\n", devices,
+				(unsigned long long) total, seconds, total / seconds);
+	}
+
+	fflush(stdout);
+
+	for (uint32_t i = 1; outputs && i < devices; i++)
+	{
+		if (!outputs[i])
+			continue;
+
+		char buffer[64 * 1024];
+		size_t size;
+
+		rewind(outputs[i]);
+		while ((size = fread(buffer, 1, sizeof(buffer), outputs[i])) > 0)
+			fwrite(buffer, 1, size, stdout);
+
+		fclose(outputs[i]);
+	}
 
-	sender_destroy(sender);
-	free(sender);
+	free(senders);
+	free(outputs);
+	free(names);
+	free(hosts);
 
 	return res;
 }
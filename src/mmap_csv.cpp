@@ -0,0 +1,328 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdexcept>
+
+#include "mmap_csv.h"
+#include "csv_scan.h"
+
+
+#define MAX_FAST_DIGITS     19
+#define MAX_EXACT_MANTISSA  (1ull << 53)
+#define MAX_EXACT_POW10     22
+
+#define INDEX_CAPACITY      (16 * 1024)
+#define MAX_SCAN_CHUNK      (1u << 20)
+
+
+static const double pow10_table[MAX_EXACT_POW10 + 1] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+static inline int is_digit(char c)
+{
+	return (unsigned char) (c - '0') < 10;
+}
+
+
+//
+// Fallback for inputs the fast path can't round exactly (long mantissas,
+// large exponents, subnormals). Token contains only [+-.0-9eE] here,
+// so strtof behaves the same in any "C"-like locale.
+//
+static float parse_float_slow(const char* begin, const char* end)
+{
+	char local[64];
+	std::string heap;
+	const size_t len = end - begin;
+	const char* str;
+
+	if (len < sizeof(local))
+	{
+		memcpy(local, begin, len);
+		local[len] = '\0';
+		str = local;
+	}
+	else
+	{
+		heap.assign(begin, len);
+		str = heap.c_str();
+	}
+
+	char* stop = NULL;
+	float value = strtof(str, &stop);
+
+	if (stop == str || *stop != '\0')
+		return 0.0f;
+
+	// Same as std::num_get: overflow is clamped to the largest value
+	if (value > FLT_MAX)
+		return FLT_MAX;
+	if (value < -FLT_MAX)
+		return -FLT_MAX;
+
+	return value;
+}
+
+
+float csv_parse_float(const char*& p, const char* end)
+{
+	const char* s = p;
+
+	while (s < end && (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\v' || *s == '\f'))
+		s++;
+
+	const char* token = s;
+	uint8_t negative = 0;
+
+	if (s < end && (*s == '-' || *s == '+'))
+		negative = *s++ == '-';
+
+	uint64_t mantissa = 0;
+	int32_t  digits = 0;
+	int32_t  exp10 = 0;
+	uint8_t  inexact = 0;
+	uint8_t  any = 0;
+
+	while (s < end && *s == '0')
+	{
+		s++;
+		any = 1;
+	}
+
+	for (; s < end && is_digit(*s); s++, any = 1)
+	{
+		if (digits < MAX_FAST_DIGITS)
+		{
+			mantissa = mantissa * 10 + (*s - '0');
+			digits++;
+		}
+		else
+		{
+			inexact |= *s != '0';
+			exp10++;
+		}
+	}
+
+	if (s < end && *s == '.')
+	{
+		s++;
+
+		if (digits == 0)
+		{
+			for (; s < end && *s == '0'; s++, any = 1)
+				exp10--;
+		}
+
+		for (; s < end && is_digit(*s); s++, any = 1)
+		{
+			if (digits < MAX_FAST_DIGITS)
+			{
+				mantissa = mantissa * 10 + (*s - '0');
+				digits++;
+				exp10--;
+			}
+			else
+				inexact |= *s != '0';
+		}
+	}
+
+	if (!any)
+	{
+		// Not a number: like `istream >> float`, the field reads as zero
+		p = s;
+		return 0.0f;
+	}
+
+	if (s < end && (*s == 'e' || *s == 'E'))
+	{
+		const char* e = s + 1;
+		uint8_t expNegative = 0;
+		int32_t exponent = 0;
+
+		if (e < end && (*e == '-' || *e == '+'))
+			expNegative = *e++ == '-';
+
+		if (e >= end || !is_digit(*e))
+		{
+			// Dangling exponent is rejected by std::num_get as a whole
+			p = e;
+			return 0.0f;
+		}
+
+		for (; e < end && is_digit(*e); e++)
+			if (exponent < 100000)
+				exponent = exponent * 10 + (*e - '0');
+
+		exp10 += expNegative ? -exponent : exponent;
+		s = e;
+	}
+
+	p = s;
+
+	if (mantissa == 0 && !inexact)
+		return negative ? -0.0f : 0.0f;
+
+	if (!inexact && mantissa <= MAX_EXACT_MANTISSA &&
+		exp10 >= -MAX_EXACT_POW10 && exp10 <= MAX_EXACT_POW10)
+	{
+		double value = (double) mantissa;
+		value = exp10 < 0 ? value / pow10_table[-exp10] : value * pow10_table[exp10];
+
+		// Correctly rounded double; converting it to float is exact
+		// unless it lands right between two floats (double rounding)
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		if ((bits & 0x1fffffffull) != 0x10000000ull && value >= FLT_MIN && value <= FLT_MAX)
+			return negative ? -(float) value : (float) value;
+	}
+
+	return parse_float_slow(token, s);
+}
+
+
+void MmapCsvReader::InitIndex()
+{
+	m_Index = (uint32_t*) malloc(INDEX_CAPACITY * sizeof(uint32_t));
+	if (!m_Index)
+		throw std::runtime_error("MmapCsvReader: Failed to alloc index");
+}
+
+
+MmapCsvReader::MmapCsvReader(const char* data, size_t size)
+	: m_Index(NULL), m_IndexPos(0), m_IndexCount(0), m_IndexBase(NULL), m_ScanPos(data),
+	  m_Data(data), m_Pos(data), m_End(data + size), m_Size(size), m_Mapped(false),
+	  m_DelimiterChar(MMAP_CSV_DELIMITER_SYMBOL)
+{
+	InitIndex();
+}
+
+
+MmapCsvReader::MmapCsvReader(const std::string& fileName)
+	: m_Index(NULL), m_IndexPos(0), m_IndexCount(0), m_IndexBase(NULL), m_ScanPos(NULL),
+	  m_Data(NULL), m_Pos(NULL), m_End(NULL), m_Size(0), m_Mapped(false),
+	  m_DelimiterChar(MMAP_CSV_DELIMITER_SYMBOL)
+{
+	InitIndex();
+
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		free(m_Index);
+		throw std::runtime_error("MmapCsvReader: File open error - \"" + fileName + "\"");
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		close(fd);
+		free(m_Index);
+		throw std::runtime_error("MmapCsvReader: Not a regular file - \"" + fileName + "\"");
+	}
+
+	m_Size = st.st_size;
+
+	if (m_Size > 0)
+	{
+		void* data = mmap(NULL, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			free(m_Index);
+			throw std::runtime_error("MmapCsvReader: File map error - \"" + fileName + "\"");
+		}
+
+		madvise(data, m_Size, MADV_SEQUENTIAL);
+		m_Data = (const char*) data;
+		m_Mapped = true;
+	}
+
+	close(fd);
+
+	m_Pos = m_Data;
+	m_End = m_Data + m_Size;
+
+	ResetIndex(m_Pos);
+}
+
+
+MmapCsvReader::~MmapCsvReader()
+{
+	if (m_Mapped)
+		munmap((void*) m_Data, m_Size);
+
+	free(m_Index);
+}
+
+
+const char* MmapCsvReader::NextSeparator()
+{
+	while (m_IndexPos == m_IndexCount)
+	{
+		if (m_ScanPos >= m_End)
+			return m_End;
+
+		size_t size = m_End - m_ScanPos;
+		if (size > MAX_SCAN_CHUNK)
+			size = MAX_SCAN_CHUNK;
+
+		size_t scanned = 0;
+
+		m_IndexBase = m_ScanPos;
+		m_IndexCount = csv_scan(m_ScanPos, size, m_DelimiterChar, m_Index, INDEX_CAPACITY, &scanned);
+		m_IndexPos = 0;
+		m_ScanPos += scanned;
+	}
+
+	return m_IndexBase + m_Index[m_IndexPos++];
+}
+
+
+size_t MmapCsvReader::ReadLine(float* values, size_t capacity)
+{
+	if (m_Pos >= m_End)
+		return 0;
+
+	const char* p = m_Pos;
+	size_t count = 0;
+
+	for (;;)
+	{
+		const char* separator = NextSeparator();
+
+		if (count < capacity)
+		{
+			const char* field = p;
+			values[count] = csv_parse_float(field, separator);
+		}
+
+		count++;
+
+		if (separator >= m_End)
+		{
+			m_Pos = m_End;
+			break;
+		}
+
+		p = separator + 1;
+
+		if (*separator == '\n')
+		{
+			m_Pos = p;
+			break;
+		}
+	}
+
+	return count;
+}
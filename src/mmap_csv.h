@@ -0,0 +1,100 @@
+#ifndef MMAP_CSV_H
+#define MMAP_CSV_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+
+#define MMAP_CSV_DELIMITER_SYMBOL ','
+
+
+//
+// CSV reader working in place over a memory mapped file.
+// Lines are scanned directly in the mapping and numeric fields are
+// converted straight into the caller's buffer: no per-line allocations.
+// Field boundaries come from an index built for a whole chunk at once
+// by the vectorized scanner (csv_scan.h).
+//
+class MmapCsvReader
+{
+public:
+	MmapCsvReader(const std::string& fileName);
+	// Reader over a memory range owned by the caller
+	MmapCsvReader(const char* data, size_t size);
+	~MmapCsvReader();
+
+	void SetDelimiterChar(char delimiterChar)
+	{
+		m_DelimiterChar = delimiterChar;
+		ResetIndex(m_Pos);
+	}
+
+	// Parses next line into values[0..capacity). Returns the number of
+	// fields in the line (fields beyond capacity are counted, not stored)
+	// or 0 at the end of file.
+	size_t ReadLine(float* values, size_t capacity);
+
+	void Rewind()
+	{
+		m_Pos = m_Data;
+		ResetIndex(m_Pos);
+	}
+
+	// Continues reading from the line starting at `offset`
+	void Seek(size_t offset)
+	{
+		m_Pos = m_Data + (offset < m_Size ? offset : m_Size);
+		ResetIndex(m_Pos);
+	}
+
+	const char* Data() const
+	{
+		return m_Data;
+	}
+
+	// Start of the next line to read
+	const char* Position() const
+	{
+		return m_Pos;
+	}
+
+	size_t Size() const
+	{
+		return m_Size;
+	}
+
+private:
+	MmapCsvReader(const MmapCsvReader&);
+	MmapCsvReader& operator=(const MmapCsvReader&);
+
+	void ResetIndex(const char* from)
+	{
+		m_ScanPos = from;
+		m_IndexPos = m_IndexCount = 0;
+	}
+
+	void InitIndex();
+	const char* NextSeparator();
+
+	uint32_t*   m_Index;            // Separator offsets relative to m_IndexBase
+	size_t      m_IndexPos;
+	size_t      m_IndexCount;
+	const char* m_IndexBase;
+	const char* m_ScanPos;          // End of the indexed area
+
+	const char* m_Data;
+	const char* m_Pos;
+	const char* m_End;
+	size_t      m_Size;
+	bool        m_Mapped;
+	char        m_DelimiterChar;
+};
+
+
+// Locale independent float parser, same result as `istream >> float`
+// for a single CSV field. Advances `p` past the parsed number.
+float csv_parse_float(const char*& p, const char* end);
+
+
+#endif // MMAP_CSV_H
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "packet_cache.h"
+#include "checksum.h"
+#include "protocol.h"
+
+
+static uint32_t protocol_layout()
+{
+	const uint32_t layout[] =
+	{
+		sizeof(PacketHeader),
+		PREAMBLE,
+		TYPE_DATASET_SAMPLE,
+		sizeof(float),
+		sizeof(uint16_t),
+	};
+
+	return (uint32_t) dataset_hash(layout, sizeof(layout));
+}
+
+
+static PacketCache* packet_cache_map(const char* fileName, uint64_t datasetHash, uint32_t columnsInSample)
+{
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(PacketCacheHeader))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return NULL;
+
+	PacketCache* cache = (PacketCache*) calloc(1, sizeof(PacketCache));
+	if (!cache)
+	{
+		munmap(data, st.st_size);
+		return NULL;
+	}
+
+	cache->data = (const uint8_t*) data;
+	cache->size = st.st_size;
+	memcpy(&cache->header, data, sizeof(PacketCacheHeader));
+
+	const PacketCacheHeader* h = &cache->header;
+	const uint32_t packetSize = sizeof(PacketHeader) + columnsInSample * sizeof(float) + sizeof(uint16_t);
+
+	if (h->magic != PACKET_CACHE_MAGIC || h->layout != protocol_layout() ||
+		h->datasetHash != datasetHash || h->columnsCount != columnsInSample ||
+		h->packetSize != packetSize || h->headerSize < sizeof(PacketCacheHeader) ||
+		h->headerSize > cache->size || (cache->size - h->headerSize) / packetSize < h->packetsCount)
+	{
+		packet_cache_close(cache);
+		return NULL;
+	}
+
+	cache->packets = cache->data + h->headerSize;
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	return cache;
+}
+
+
+static int packet_cache_build(const char* fileName, DatasetReader* dataset,
+							  uint64_t datasetHash, uint32_t columnsInSample)
+{
+	const uint32_t sampleSize = columnsInSample * sizeof(float);
+	const uint32_t packetSize = sizeof(PacketHeader) + sampleSize + sizeof(uint16_t);
+
+	if (packetSize > UINT16_MAX)
+	{
+		fprintf(stderr, "%s: sample too big\n", __func__);
+		return 1;
+	}
+
+	uint8_t* packet = (uint8_t*) calloc(1, packetSize);
+	if (!packet)
+		return 2;
+
+	const std::string tmpName = std::string(fileName) + ".tmp";
+
+	FILE* f = fopen(tmpName.c_str(), "wb");
+	if (!f)
+	{
+		fprintf(stderr, "Failed to create %s\n", tmpName.c_str());
+		free(packet);
+		return 3;
+	}
+
+	PacketCacheHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+
+	hdr.magic = PACKET_CACHE_MAGIC;
+	hdr.layout = protocol_layout();
+	hdr.datasetHash = datasetHash;
+	hdr.columnsCount = columnsInSample;
+	hdr.packetSize = packetSize;
+	hdr.headerSize = sizeof(PacketCacheHeader);
+
+	PacketHeader* ph = (PacketHeader*) packet;
+	float* sample = (float*) (ph + 1);
+
+	ph->preamble = PREAMBLE;
+	ph->size = packetSize;
+	ph->type = TYPE_DATASET_SAMPLE;
+	ph->error = ERROR_SUCCESS;
+	sample[columnsInSample - 1] = 1.0;
+
+	int res = fwrite(&hdr, sizeof(hdr), 1, f) == 1 ? 1 : -2;
+
+	while (res == 1 && (res = dataset->ReadRow(sample)) == 1)
+	{
+		uint16_t crc = crc16_table(packet, packetSize - sizeof(uint16_t), 0);
+		memcpy(packet + packetSize - sizeof(uint16_t), &crc, sizeof(uint16_t));
+
+		if (fwrite(packet, packetSize, 1, f) != 1)
+			res = -2;
+		else
+			hdr.packetsCount++;
+	}
+
+	if (res == 0 && (0 != fseek(f, 0, SEEK_SET) || fwrite(&hdr, sizeof(hdr), 1, f) != 1))
+		res = -2;
+
+	if (0 != fclose(f) && res == 0)
+		res = -2;
+
+	free(packet);
+
+	if (res == 0 && 0 != rename(tmpName.c_str(), fileName))
+		res = -2;
+
+	if (res != 0)
+	{
+		if (res == -1)
+			fprintf(stderr, "%s: malformed row #%llu\n", __func__, (unsigned long long) hdr.packetsCount + 1);
+		else
+			fprintf(stderr, "Failed to write %s\n", fileName);
+
+		unlink(tmpName.c_str());
+		return 4;
+	}
+
+	return 0;
+}
+
+
+PacketCache* packet_cache_open(const char* fileName, DatasetReader* dataset, uint32_t columnsInSample)
+{
+	const uint64_t datasetHash = dataset->Hash();
+
+	PacketCache* cache = packet_cache_map(fileName, datasetHash, columnsInSample);
+	if (cache)
+	{
+		fprintf(stderr, "Packet cache: %s, %llu packets\n", fileName,
+				(unsigned long long) cache->header.packetsCount);
+		return cache;
+	}
+
+	fprintf(stderr, "Packet cache: building %s\n", fileName);
+
+	if (0 != packet_cache_build(fileName, dataset, datasetHash, columnsInSample))
+		return NULL;
+
+	cache = packet_cache_map(fileName, datasetHash, columnsInSample);
+	if (cache)
+		fprintf(stderr, "Packet cache: %s, %llu packets\n", fileName,
+				(unsigned long long) cache->header.packetsCount);
+
+	return cache;
+}
+
+
+void packet_cache_close(PacketCache* cache)
+{
+	if (!cache)
+		return;
+
+	if (cache->data)
+		munmap((void*) cache->data, cache->size);
+
+	free(cache);
+}
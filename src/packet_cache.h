@@ -0,0 +1,60 @@
+#ifndef PACKET_CACHE_H
+#define PACKET_CACHE_H
+
+#include <stdint.h>
+
+#include "dataset.h"
+
+
+//
+// File with all TYPE_DATASET_SAMPLE packets of a dataset pre-encoded
+// (header + sample with bias + crc), ready to be sent as is:
+// - header
+// - packets, packetSize bytes each
+//
+
+
+#define PACKET_CACHE_MAGIC      (0x3143504Eu)   // "NPC1"
+
+
+typedef struct
+{
+	uint32_t magic;             // Must be equal PACKET_CACHE_MAGIC
+	uint32_t layout;            // Protocol layout fingerprint
+	uint64_t datasetHash;       // DatasetReader::Hash() of the source
+	uint32_t columnsCount;      // Columns in sample (with bias)
+	uint32_t packetSize;        // Bytes per packet
+	uint64_t packetsCount;
+	uint32_t headerSize;        // Offset of the first packet
+	uint32_t reserved;
+}
+PacketCacheHeader;
+
+
+typedef struct
+{
+	PacketCacheHeader header;
+	const uint8_t*    data;
+	uint64_t          size;
+	const uint8_t*    packets;
+}
+PacketCache;
+
+
+// Maps cache file, (re)building it from `dataset` when it is missing or
+// was made for other dataset contents or protocol layout
+PacketCache* packet_cache_open(const char* fileName, DatasetReader* dataset, uint32_t columnsInSample);
+void packet_cache_close(PacketCache* cache);
+
+static inline const uint8_t* packet_cache_packet(const PacketCache* cache, uint64_t index)
+{
+	return cache->packets + index * cache->header.packetSize;
+}
+
+static inline uint8_t packet_cache_owns(const PacketCache* cache, const void* ptr)
+{
+	return cache && (const uint8_t*) ptr >= cache->data && (const uint8_t*) ptr < cache->data + cache->size;
+}
+
+
+#endif // PACKET_CACHE_H
@@ -0,0 +1,223 @@
+#include <string.h>
+
+#include <stdexcept>
+
+#include "parallel_csv.h"
+#include "row_index.h"
+
+
+#define CHUNK_SIZE          (1u << 20)
+#define CHUNKS_PER_THREAD   2
+
+
+ParallelCsvReader::ParallelCsvReader(const std::string& fileName, uint32_t threads)
+	: m_FileName(fileName), m_File(fileName), m_Columns(0), m_DataOffset(0),
+	  m_ThreadsCount(threads ? threads : 1), m_Next(NULL), m_End(NULL),
+	  m_Dispatched(0), m_Consumed(0), m_Current(NULL), m_Row(0), m_Stop(false)
+{
+	m_Columns = m_File.ReadLine(NULL, 0);
+	m_DataOffset = m_File.Position() - m_File.Data();
+
+	m_End = m_File.Data() + m_File.Size();
+
+	m_Chunks.resize(m_ThreadsCount * CHUNKS_PER_THREAD);
+
+	Start(m_File.Position());
+}
+
+
+void ParallelCsvReader::Start(const char* from)
+{
+	m_Next = from;
+	m_Dispatched = 0;
+	m_Consumed = 0;
+	m_Current = NULL;
+	m_Row = 0;
+	m_Stop = false;
+
+	for (size_t i = 0; i < m_Chunks.size(); i++)
+	{
+		m_Chunks[i].index = 0;
+		m_Chunks[i].ready = false;
+	}
+
+	try
+	{
+		for (uint32_t i = 0; i < m_ThreadsCount; i++)
+			m_Threads.push_back(std::thread(&ParallelCsvReader::Worker, this));
+	}
+	catch (std::exception&)
+	{
+		Stop();
+		throw std::runtime_error("ParallelCsvReader: Failed to start worker threads");
+	}
+}
+
+
+ParallelCsvReader::~ParallelCsvReader()
+{
+	Stop();
+}
+
+
+void ParallelCsvReader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+
+	m_WorkerCond.notify_all();
+
+	for (size_t i = 0; i < m_Threads.size(); i++)
+		m_Threads[i].join();
+
+	m_Threads.clear();
+}
+
+
+// Workers run ahead of the reader, so they are restarted at the new position
+void ParallelCsvReader::Seek(uint64_t row)
+{
+	uint64_t offset = m_DataOffset;
+
+	if (row != 0)
+		offset = row_index_offset(m_FileName, m_File.Data(), m_File.Size(), m_DataOffset, row);
+
+	Stop();
+	Start(m_File.Data() + offset);
+}
+
+
+uint64_t ParallelCsvReader::Hash()
+{
+	return dataset_hash(m_File.Data(), m_File.Size());
+}
+
+
+uint64_t ParallelCsvReader::Rows()
+{
+	return row_index_rows(m_FileName, m_File.Data(), m_File.Size(), m_DataOffset);
+}
+
+
+void ParallelCsvReader::Parse(Chunk& chunk)
+{
+	MmapCsvReader reader(chunk.begin, chunk.end - chunk.begin);
+
+	chunk.rows = 0;
+	chunk.malformed = false;
+
+	for (;;)
+	{
+		const size_t offset = chunk.rows * m_Columns;
+
+		if (chunk.values.size() < offset + m_Columns)
+			chunk.values.resize(chunk.values.size() * 2 + m_Columns);
+
+		size_t count = reader.ReadLine(&chunk.values[offset], m_Columns);
+		if (count == 0)
+			break;
+
+		if (count != m_Columns)
+		{
+			chunk.malformed = true;
+			break;
+		}
+
+		chunk.rows++;
+	}
+}
+
+
+void ParallelCsvReader::Worker()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	for (;;)
+	{
+		while (!m_Stop && m_Next < m_End && m_Dispatched >= m_Consumed + m_Chunks.size())
+			m_WorkerCond.wait(lock);
+
+		if (m_Stop || m_Next >= m_End)
+			return;
+
+		Chunk& chunk = m_Chunks[m_Dispatched % m_Chunks.size()];
+
+		chunk.index = m_Dispatched++;
+		chunk.ready = false;
+		chunk.begin = m_Next;
+		chunk.end = m_End;
+
+		if ((size_t) (m_End - m_Next) > CHUNK_SIZE)
+		{
+			const char* eol = (const char*) memchr(m_Next + CHUNK_SIZE, '\n', m_End - m_Next - CHUNK_SIZE);
+			if (eol)
+				chunk.end = eol + 1;
+		}
+
+		m_Next = chunk.end;
+
+		lock.unlock();
+
+		try
+		{
+			Parse(chunk);
+		}
+		catch (std::exception&)
+		{
+			chunk.rows = 0;
+			chunk.malformed = true;
+		}
+
+		lock.lock();
+
+		chunk.ready = true;
+		m_ReaderCond.notify_all();
+	}
+}
+
+
+int ParallelCsvReader::ReadRow(float* values)
+{
+	for (;;)
+	{
+		if (m_Current)
+		{
+			if (m_Row < m_Current->rows)
+			{
+				memcpy(values, &m_Current->values[m_Row * m_Columns], m_Columns * sizeof(float));
+				m_Row++;
+				return 1;
+			}
+
+			if (m_Current->malformed)
+				return -1;
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		if (m_Current)
+		{
+			m_Current = NULL;
+			m_Consumed++;
+			m_WorkerCond.notify_all();
+		}
+
+		Chunk& next = m_Chunks[m_Consumed % m_Chunks.size()];
+
+		for (;;)
+		{
+			if (m_Consumed < m_Dispatched && next.index == m_Consumed && next.ready)
+				break;
+
+			if (m_Consumed == m_Dispatched && m_Next >= m_End)
+				return 0;
+
+			m_ReaderCond.wait(lock);
+		}
+
+		m_Current = &next;
+		m_Row = 0;
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef PARALLEL_CSV_H
+#define PARALLEL_CSV_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "mmap_csv.h"
+
+
+//
+// CSV dataset parsed by a pool of worker threads.
+// The file is cut into newline aligned chunks, each worker parses whole
+// chunks into float rows, the reader hands rows out strictly in file order.
+//
+class ParallelCsvReader : public DatasetReader
+{
+public:
+	ParallelCsvReader(const std::string& fileName, uint32_t threads);
+	~ParallelCsvReader();
+
+	uint32_t Columns() const
+	{
+		return m_Columns;
+	}
+
+	int ReadRow(float* values);
+	void Seek(uint64_t row);
+	uint64_t Hash();
+	uint64_t Rows();
+
+private:
+	ParallelCsvReader(const ParallelCsvReader&);
+	ParallelCsvReader& operator=(const ParallelCsvReader&);
+
+	struct Chunk
+	{
+		uint64_t           index;       // Chunk number in file order
+		const char*        begin;
+		const char*        end;
+		std::vector<float> values;
+		size_t             rows;        // Rows parsed into values
+		bool               malformed;   // Row following the parsed ones is malformed
+		bool               ready;
+	};
+
+	void Worker();
+	void Parse(Chunk& chunk);
+	void Start(const char* from);
+	void Stop();
+
+	std::string              m_FileName;
+	MmapCsvReader            m_File;
+	uint32_t                 m_Columns;
+	size_t                   m_DataOffset;   // First data row
+	uint32_t                 m_ThreadsCount;
+
+	const char*              m_Next;         // Start of the next chunk to dispatch
+	const char*              m_End;
+	uint64_t                 m_Dispatched;   // Chunks handed to workers
+	uint64_t                 m_Consumed;     // Chunks fully read by ReadRow()
+	std::vector<Chunk>       m_Chunks;       // Ring of chunks in flight
+	Chunk*                   m_Current;
+	size_t                   m_Row;
+	bool                     m_Stop;
+
+	std::mutex               m_Mutex;
+	std::condition_variable  m_WorkerCond;
+	std::condition_variable  m_ReaderCond;
+	std::vector<std::thread> m_Threads;
+};
+
+
+#endif // PARALLEL_CSV_H
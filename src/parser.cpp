@@ -7,124 +7,103 @@
 #include "protocol.h"
 
 
-typedef enum
+#define PREAMBLE_FIRST_BYTE ((PREAMBLE >> 0) & 0xff)
+
+
+uint32_t parser_buffer_size(const Parser* parser)
 {
-	PREAMBLE_1 = 0,
-	PREAMBLE_2,
-	SIZE,
-	TYPE,
-	ERROR_CODE,
-	RESERVED_BYTES,
-	PAYLOAD
+	return parser->bufferSize;
 }
-State;
 
-typedef struct
+
+uint8_t parser_init(Parser* parser, valid_packet_cb callback, void* ctx)
 {
-	State           state;
-	uint32_t        counter;
-	uint32_t        pos;
-	uint8_t*        buffer;
-	valid_packet_cb callback;
-	uint32_t        bufferSize;
-}
-Parser;
+	memset(parser, 0, sizeof(Parser));
 
-static Parser parser;
+	parser->bufferSize = 2048;
 
+	parser->buffer = (uint8_t*) calloc(1, parser->bufferSize);
+	parser->callback = callback;
+	parser->ctx = ctx;
 
-uint32_t parser_buffer_size()
+	return parser->buffer != NULL ? 0 : 1;
+}
+
+
+void parser_free(Parser* parser)
 {
-	return parser.bufferSize;
+	free(parser->buffer);
+
+	memset(parser, 0, sizeof(Parser));
 }
 
 
-uint8_t parser_init(valid_packet_cb callback)
+static inline uint8_t header_valid(const Parser* p, const PacketHeader* hdr)
 {
-	parser.bufferSize = 2048;
+	return hdr->preamble == PREAMBLE && hdr->size <= p->bufferSize &&
+		   hdr->size >= (sizeof(PacketHeader) + sizeof(uint16_t));
+}
+
 
-	parser.buffer = (uint8_t*) calloc(1, parser.bufferSize);
-	parser.callback = callback;
+static inline uint8_t crc_valid(const uint8_t* frame, uint16_t size)
+{
+	uint16_t crc_packet;
+	memcpy(&crc_packet, frame + size - sizeof(uint16_t), sizeof(uint16_t));
 
-	return parser.buffer != NULL ? 0 : 1;
+	return crc_packet == crc16_table((uint8_t*) frame, size - sizeof(uint16_t), 0);
 }
 
 
-void parser_parse(uint8_t data)
+//
+// Frames lying entirely in `data` are checked and handed out in place
+// (misaligned ones are copied). Returns number of bytes consumed: all
+// of them except an incomplete frame at the end.
+//
+size_t parser_scan(Parser* p, const uint8_t* data, size_t size)
 {
-	Parser* p = &parser;
-	PacketHeader* hdr = (PacketHeader*) parser.buffer;
+	size_t i = 0;
 
-	switch (p->state)
+	while (i < size)
 	{
-	case PREAMBLE_1:
-		if (data == ((PREAMBLE >> 0) & 0xff))
-		{
-			p->state = PREAMBLE_2;
-			p->pos = 0;
-			p->counter = 0;
-			p->buffer[p->pos++] = data;
-		}
-		break;
+		const uint8_t* start = (const uint8_t*) memchr(data + i, PREAMBLE_FIRST_BYTE, size - i);
+		if (!start)
+			return size;
 
-	case PREAMBLE_2:
-		if (data == ((PREAMBLE >> 8) & 0xff))
-		{
-			p->buffer[p->pos++] = data;
-			p->state = hdr->preamble == PREAMBLE ? SIZE : PREAMBLE_1;
-		}
-		else
-			p->state = PREAMBLE_1;
-		break;
+		i = start - data;
 
-	case SIZE:
-		p->buffer[p->pos++] = data;
-		if (++p->counter >= sizeof(hdr->size))
-		{
-			p->state = (hdr->size <= p->bufferSize) &&
-					(hdr->size >= (sizeof(PacketHeader) + sizeof(uint16_t)))
-					? TYPE : PREAMBLE_1;
-		}
-		break;
-
-	case TYPE:
-		p->buffer[p->pos++] = data;
-		p->state = ERROR_CODE;
-		break;
-
-	case ERROR_CODE:
-		p->buffer[p->pos++] = data;
-		p->state = RESERVED_BYTES;
-		p->counter = sizeof(hdr->reserved);
-		break;
-
-	case RESERVED_BYTES:
-		p->buffer[p->pos++] = data;
-		if (--p->counter <= 0)
-		{
-			p->counter = hdr->size - sizeof(PacketHeader);
-			p->state = p->counter >= sizeof(uint16_t) ? PAYLOAD : PREAMBLE_1;
-		}
-		break;
+		const size_t avail = size - i;
+		PacketHeader hdr;
+
+		if (avail < sizeof(PacketHeader))
+			return i;
+
+		memcpy(&hdr, start, sizeof(hdr));
 
-	case PAYLOAD:
-		p->buffer[p->pos++] = data;
-		if (--p->counter <= 0)
+		if (!header_valid(p, &hdr))
 		{
-			p->state = PREAMBLE_1;
-			p->pos -= sizeof(uint16_t);
+			i++;
+			continue;
+		}
 
-			uint16_t crc_packet;
-			memcpy(&crc_packet, &p->buffer[p->pos], sizeof(uint16_t));
+		if (avail < hdr.size)
+			return i;
 
-			if (crc_packet == crc16_table(p->buffer, hdr->size - sizeof(uint16_t), 0))
+		if (crc_valid(start, hdr.size))
+		{
+			// Payload is read as floats/structs by the callback
+			if ((uintptr_t) start % sizeof(uint32_t))
 			{
-				p->callback(p->buffer, hdr->size);
+				memcpy(p->buffer, start, hdr.size);
+				start = p->buffer;
 			}
-		}
-		break;
 
-	default:
-		break;
+			p->callback(p->ctx, (void*) start, hdr.size);
+			i += hdr.size;
+		}
+		else
+			i++;
 	}
+
+	return size;
 }
+
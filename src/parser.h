@@ -2,15 +2,35 @@
 #define PARSER_H
 
 
+#include <stddef.h>
 #include <stdint.h>
 
 
-typedef void (*valid_packet_cb)(void* data, uint32_t size);
+// `data` points to a complete 4-byte aligned frame with valid CRC, either in
+// the data passed to the parser or in the parser's own buffer: valid only
+// during the call. `ctx` is the pointer given to parser_init().
+typedef void (*valid_packet_cb)(void* ctx, void* data, uint32_t size);
 
 
-uint8_t parser_init(valid_packet_cb callback);
-uint32_t parser_buffer_size();
-void parser_parse(uint8_t data);
+typedef struct
+{
+	uint8_t*        buffer;         // Misaligned frame copied for the callback
+	valid_packet_cb callback;
+	void*           ctx;
+	uint32_t        bufferSize;
+}
+Parser;
+
+
+uint8_t parser_init(Parser* parser, valid_packet_cb callback, void* ctx);
+void parser_free(Parser* parser);
+// Largest frame accepted
+uint32_t parser_buffer_size(const Parser* parser);
+
+// For callers keeping received data in place (rx_ring.h): hands out
+// complete frames and returns number of bytes consumed, an incomplete
+// frame at the end is left to the caller to pass again with more data
+size_t parser_scan(Parser* parser, const uint8_t* data, size_t size);
 
 
 #endif // PARSER_H
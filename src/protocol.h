@@ -30,6 +30,12 @@ PacketHeader;
 #define PACKET_TYPE(type) ((type) & ~(1u<<7))
 
 
+static inline uint16_t packet_seq(const PacketHeader* hdr)
+{
+	return hdr->reserved[0] | (hdr->reserved[1] << 8);
+}
+
+
 typedef enum
 {
 	TYPE_ERROR = 0,
@@ -37,6 +43,7 @@ typedef enum
 	TYPE_DATASET_INFO,
 	TYPE_DATASET_SAMPLE,
 	TYPE_PERF_REPORT,
+	TYPE_DATASET_BATCH,
 }
 PacketType;
 
@@ -59,6 +66,36 @@ typedef struct
 DatasetInfo;
 
 
+//
+// Optional tail of DatasetInfo, sent only to negotiate pipelined upload.
+// The device answers with the options it accepted; an empty answer means
+// stop-and-wait. With window > 1 or batches every sample packet carries
+// a sequence number in PacketHeader::reserved, echoed in its answer.
+//
+typedef struct
+{
+	uint16_t window;                // Packets in flight (1 - stop-and-wait)
+	uint16_t flags;                 // DATASET_FLAG_*
+	uint32_t bufferSize;            // Largest frame the side can receive, bytes
+}
+DatasetOptions;
+
+
+#define DATASET_FLAG_BATCH      (1u << 0)   // TYPE_DATASET_BATCH supported
+
+
+//
+// TYPE_DATASET_BATCH payload: header followed by `count` consecutive
+// samples, the answer - header followed by `count` results
+//
+typedef struct
+{
+	uint16_t count;
+	uint16_t reserved;
+}
+DatasetBatch;
+
+
 typedef struct
 {
 	uint16_t columnsCount;         	// Columns count in result
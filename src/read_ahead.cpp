@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "read_ahead.h"
+
+
+ReadAhead::ReadAhead(DatasetReader* reader, uint32_t depth)
+	: m_Reader(reader), m_Columns(reader->Columns()), m_Depth(depth ? depth : 1), m_Slots(NULL),
+	  m_Head(0), m_Tail(0), m_Status(RUNNING), m_Stop(false),
+	  m_ConsumerWaiting(false), m_ProducerWaiting(false), m_Stalls(0),
+	  m_Trace(NULL), m_TraceDevice(0)
+{
+}
+
+
+ReadAhead::~ReadAhead()
+{
+	if (m_Thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+
+		m_Cond.notify_all();
+		m_Thread.join();
+	}
+
+	free(m_Slots);
+}
+
+
+bool ReadAhead::Start()
+{
+	m_Slots = (float*) calloc((size_t) m_Depth * m_Columns, sizeof(float));
+	if (!m_Slots)
+		return false;
+
+	try
+	{
+		m_Thread = std::thread(&ReadAhead::Run, this);
+	}
+	catch (std::exception&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void ReadAhead::Finish(Status status)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Status = status;
+	}
+
+	m_Cond.notify_all();
+}
+
+
+void ReadAhead::Run()
+{
+	for (;;)
+	{
+		const uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+
+		if (tail - m_Head.load(std::memory_order_acquire) >= m_Depth)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			m_ProducerWaiting = true;
+			while (tail - m_Head.load() >= m_Depth && !m_Stop)
+				m_Cond.wait(lock);
+			m_ProducerWaiting = false;
+		}
+
+		if (m_Stop)
+			return;
+
+		const uint64_t traceAt = trace_now(m_Trace);
+
+		int res = m_Reader->ReadRow(Slot(tail));
+		trace_span(m_Trace, TRACE_PARSE, NULL, m_TraceDevice, traceAt, 1);
+
+		if (res != 1)
+		{
+			Finish(res == 0 ? FINISHED : FAILED);
+			return;
+		}
+
+		m_Tail.store(tail + 1);
+
+		if (m_ConsumerWaiting)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Cond.notify_all();
+		}
+	}
+}
+
+
+int ReadAhead::Pop(float* values)
+{
+	const uint64_t head = m_Head.load(std::memory_order_relaxed);
+
+	if (m_Tail.load(std::memory_order_acquire) == head)
+	{
+		if (m_Status == RUNNING)
+		{
+			m_Stalls++;
+
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			m_ConsumerWaiting = true;
+			while (m_Tail.load() == head && m_Status == RUNNING)
+				m_Cond.wait(lock);
+			m_ConsumerWaiting = false;
+		}
+
+		if (m_Tail.load(std::memory_order_acquire) == head)
+			return m_Status == FINISHED ? 0 : -1;
+	}
+
+	memcpy(values, Slot(head), m_Columns * sizeof(float));
+
+	m_Head.store(head + 1);
+
+	if (m_ProducerWaiting)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Cond.notify_all();
+	}
+
+	return 1;
+}
@@ -0,0 +1,83 @@
+#ifndef READ_AHEAD_H
+#define READ_AHEAD_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "dataset.h"
+#include "trace.h"
+
+
+//
+// Parses dataset rows in a background thread into a bounded
+// single-producer/single-consumer ring, so the uv loop only copies
+// ready samples out of it.
+//
+class ReadAhead
+{
+public:
+	// `depth` - rows parsed ahead
+	ReadAhead(DatasetReader* reader, uint32_t depth);
+	~ReadAhead();
+
+	// Parsed rows are traced into `trace` (owned by the caller), set before Start()
+	void SetTrace(Trace* trace, uint32_t device)
+	{
+		m_Trace = trace;
+		m_TraceDevice = device;
+	}
+
+	bool Start();
+
+	// Copies next row into values[0..reader->Columns()).
+	// Returns 1 - row copied, 0 - end of dataset, -1 - malformed row
+	int Pop(float* values);
+
+	// How many times Pop() had to wait for the parser
+	uint64_t Stalls() const
+	{
+		return m_Stalls;
+	}
+
+private:
+	ReadAhead(const ReadAhead&);
+	ReadAhead& operator=(const ReadAhead&);
+
+	enum Status { RUNNING = 0, FINISHED, FAILED };
+
+	void Run();
+	void Finish(Status status);
+
+	float* Slot(uint64_t index)
+	{
+		return m_Slots + (index % m_Depth) * m_Columns;
+	}
+
+	DatasetReader*          m_Reader;
+	uint32_t                m_Columns;
+	uint32_t                m_Depth;
+	float*                  m_Slots;
+
+	std::atomic<uint64_t>   m_Head;             // Next row to pop
+	std::atomic<uint64_t>   m_Tail;             // Next row to fill
+	std::atomic<int>        m_Status;
+	std::atomic<bool>       m_Stop;
+	std::atomic<bool>       m_ConsumerWaiting;
+	std::atomic<bool>       m_ProducerWaiting;
+
+	std::mutex              m_Mutex;
+	std::condition_variable m_Cond;
+	std::thread             m_Thread;
+
+	uint64_t                m_Stalls;
+
+	Trace*                  m_Trace;
+	uint32_t                m_TraceDevice;
+};
+
+
+#endif // READ_AHEAD_H
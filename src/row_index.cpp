@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "row_index.h"
+
+
+#define MIN_PART_SIZE       (4u << 20)
+
+
+// Part of the file scanned by one thread
+typedef struct
+{
+	const char* begin;
+	const char* end;
+	uint64_t*   offsets;        // Where the part's row offsets go
+	uint64_t    count;          // Rows starting in the part
+}
+IndexPart;
+
+
+static void count_rows(IndexPart* part, const char* data)
+{
+	(void) data;
+
+	part->count = 0;
+
+	for (const char* p = part->begin; (p = (const char*) memchr(p, '\n', part->end - p)); p++)
+		part->count++;
+}
+
+
+static void fill_rows(IndexPart* part, const char* data)
+{
+	uint64_t* out = part->offsets;
+
+	for (const char* p = part->begin; (p = (const char*) memchr(p, '\n', part->end - p)); p++)
+		*out++ = p + 1 - data;
+}
+
+
+static void run_parts(std::vector<IndexPart>& parts, void (*fn)(IndexPart*, const char*), const char* data)
+{
+	std::vector<std::thread> threads;
+	size_t started = 1;
+
+	threads.reserve(parts.size());
+
+	try
+	{
+		for (; started < parts.size(); started++)
+			threads.push_back(std::thread(fn, &parts[started], data));
+	}
+	catch (std::exception&)
+	{
+	}
+
+	// Whatever didn't get a thread runs here
+	for (size_t i = started; i < parts.size(); i++)
+		fn(&parts[i], data);
+
+	fn(&parts[0], data);
+
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+
+//
+// Every line after the CSV header starts a data row, except for the
+// empty "line" after the trailing newline. Newlines in the data are
+// counted by all threads, each in its own part. Returns rows count.
+//
+static uint64_t count_parts(std::vector<IndexPart>& parts, const char* data, uint64_t size, uint64_t dataOffset)
+{
+	if (dataOffset >= size)
+		return 0;
+
+	const char* begin = data + dataOffset;
+	const char* end = data + size - 1;
+
+	uint64_t threads = std::thread::hardware_concurrency();
+	if (threads > (uint64_t) (end - begin) / MIN_PART_SIZE)
+		threads = (end - begin) / MIN_PART_SIZE;
+	if (threads == 0)
+		threads = 1;
+
+	parts.resize(threads);
+	const uint64_t partSize = (end - begin) / threads;
+
+	for (uint64_t i = 0; i < threads; i++)
+	{
+		parts[i].begin = begin + i * partSize;
+		parts[i].end = (i + 1 == threads) ? end : parts[i].begin + partSize;
+	}
+
+	run_parts(parts, count_rows, data);
+
+	uint64_t rows = 1;
+	for (uint64_t i = 0; i < threads; i++)
+		rows += parts[i].count;
+
+	return rows;
+}
+
+
+// Rows are counted first, then each thread writes its offsets at its own position
+static std::vector<uint64_t> row_index_build(const char* data, uint64_t size, uint64_t dataOffset)
+{
+	std::vector<uint64_t> offsets;
+	std::vector<IndexPart> parts;
+
+	uint64_t rows = count_parts(parts, data, size, dataOffset);
+	if (!rows)
+		return offsets;
+
+	offsets.resize(rows);
+	offsets[0] = dataOffset;
+
+	rows = 1;
+	for (uint64_t i = 0; i < parts.size(); i++)
+	{
+		parts[i].offsets = &offsets[rows];
+		rows += parts[i].count;
+	}
+
+	run_parts(parts, fill_rows, data);
+
+	return offsets;
+}
+
+
+// Saving is best effort: a read-only dataset directory only costs a rebuild next time
+static void row_index_save(const std::string& indexName, const RowIndexHeader& hdr,
+						   const std::vector<uint64_t>& offsets)
+{
+	const std::string tmpName = indexName + ".tmp";
+
+	FILE* f = fopen(tmpName.c_str(), "wb");
+	if (!f)
+	{
+		fprintf(stderr, "Row index: failed to create %s\n", tmpName.c_str());
+		return;
+	}
+
+	int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+	if (ok && !offsets.empty())
+		ok = fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), f) == offsets.size();
+
+	if (0 != fclose(f))
+		ok = 0;
+
+	if (!ok || 0 != rename(tmpName.c_str(), indexName.c_str()))
+	{
+		fprintf(stderr, "Row index: failed to write %s\n", indexName.c_str());
+		unlink(tmpName.c_str());
+	}
+}
+
+
+//
+// Looks up row offset in a saved index matching `expected`, reading
+// just the header and a single entry.
+// Returns 1 - found, 0 - no valid index, -1 - row out of range
+//
+static int row_index_lookup(const std::string& indexName, RowIndexHeader* expected,
+							uint64_t row, uint64_t* offset)
+{
+	int fd = open(indexName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	RowIndexHeader hdr;
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr) ||
+		hdr.magic != expected->magic || hdr.headerSize < sizeof(RowIndexHeader) ||
+		hdr.headerSize > (uint64_t) st.st_size ||
+		hdr.sourceSize != expected->sourceSize || hdr.dataOffset != expected->dataOffset ||
+		hdr.sourceMtimeSec != expected->sourceMtimeSec ||
+		hdr.sourceMtimeNsec != expected->sourceMtimeNsec ||
+		((uint64_t) st.st_size - hdr.headerSize) / sizeof(uint64_t) < hdr.rowsCount)
+	{
+		close(fd);
+		return 0;
+	}
+
+	expected->rowsCount = hdr.rowsCount;
+
+	int res = 1;
+
+	if (row > hdr.rowsCount)
+		res = -1;
+	else if (row == hdr.rowsCount)
+		*offset = hdr.sourceSize;
+	else if (pread(fd, offset, sizeof(*offset), hdr.headerSize + row * sizeof(uint64_t)) != sizeof(*offset))
+		res = 0;
+
+	close(fd);
+
+	return res;
+}
+
+
+// Modification time of the source, the field is named differently on macOS
+static void file_mtime(const struct stat* st, int64_t* sec, int64_t* nsec)
+{
+#if defined(__APPLE__)
+	*sec = st->st_mtimespec.tv_sec;
+	*nsec = st->st_mtimespec.tv_nsec;
+#else
+	*sec = st->st_mtim.tv_sec;
+	*nsec = st->st_mtim.tv_nsec;
+#endif
+}
+
+
+// Header of the index matching the current state of the source file
+static RowIndexHeader row_index_expected(const std::string& fileName, uint64_t size, uint64_t dataOffset)
+{
+	struct stat st;
+	if (stat(fileName.c_str(), &st) != 0 || (uint64_t) st.st_size != size)
+		throw std::runtime_error("Row index: Failed to stat \"" + fileName + "\"");
+
+	RowIndexHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+
+	hdr.magic = ROW_INDEX_MAGIC;
+	hdr.headerSize = sizeof(RowIndexHeader);
+	hdr.sourceSize = size;
+	file_mtime(&st, &hdr.sourceMtimeSec, &hdr.sourceMtimeNsec);
+	hdr.dataOffset = dataOffset;
+
+	return hdr;
+}
+
+
+uint64_t row_index_offset(const std::string& fileName, const char* data, uint64_t size,
+						  uint64_t dataOffset, uint64_t row)
+{
+	RowIndexHeader hdr = row_index_expected(fileName, size, dataOffset);
+
+	const std::string indexName = fileName + ".idx";
+
+	uint64_t offset = 0;
+	int res = row_index_lookup(indexName, &hdr, row, &offset);
+
+	if (res == 0)
+	{
+		fprintf(stderr, "Row index: building %s\n", indexName.c_str());
+
+		std::vector<uint64_t> offsets = row_index_build(data, size, dataOffset);
+
+		hdr.rowsCount = offsets.size();
+		row_index_save(indexName, hdr, offsets);
+
+		res = row > hdr.rowsCount ? -1 : 1;
+		offset = row < hdr.rowsCount ? offsets[row] : size;
+	}
+
+	fprintf(stderr, "Row index: %s, %llu rows\n", indexName.c_str(), (unsigned long long) hdr.rowsCount);
+
+	if (res < 0)
+	{
+		char msg[128];
+		snprintf(msg, sizeof(msg), "Row index: row %llu is out of range (%llu rows)",
+				 (unsigned long long) row, (unsigned long long) hdr.rowsCount);
+		throw std::out_of_range(msg);
+	}
+
+	return offset;
+}
+
+
+uint64_t row_index_rows(const std::string& fileName, const char* data, uint64_t size,
+						uint64_t dataOffset)
+{
+	RowIndexHeader hdr = row_index_expected(fileName, size, dataOffset);
+	uint64_t offset = 0;
+
+	if (row_index_lookup(fileName + ".idx", &hdr, 0, &offset) == 1)
+		return hdr.rowsCount;
+
+	std::vector<IndexPart> parts;
+
+	return count_parts(parts, data, size, dataOffset);
+}
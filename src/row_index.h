@@ -0,0 +1,45 @@
+#ifndef ROW_INDEX_H
+#define ROW_INDEX_H
+
+#include <stdint.h>
+#include <string>
+
+
+//
+// Sidecar index of CSV data rows, `<dataset>.idx`:
+// - header
+// - offsets: uint64 file offset of every data row, in file order
+//
+
+
+#define ROW_INDEX_MAGIC         (0x3158524Eu)   // "NRX1"
+
+
+typedef struct
+{
+	uint32_t magic;             // Must be equal ROW_INDEX_MAGIC
+	uint32_t headerSize;        // Offset of the first row offset
+	uint64_t sourceSize;        // Dataset file size
+	int64_t  sourceMtimeSec;    // Dataset file modification time
+	int64_t  sourceMtimeNsec;
+	uint64_t dataOffset;        // Offset of the first data row (after CSV header)
+	uint64_t rowsCount;
+}
+RowIndexHeader;
+
+
+// Returns file offset of data row `row` (0 - first row after the CSV
+// header, rowsCount - end of file) of dataset `fileName` mapped at `data`.
+// The index is loaded from `<fileName>.idx`, or built in parallel and
+// saved there when missing or stale (dataset size or mtime changed).
+// Throws std::exception on failure, including `row` out of range.
+uint64_t row_index_offset(const std::string& fileName, const char* data, uint64_t size,
+						  uint64_t dataOffset, uint64_t row);
+
+// Number of data rows: from a valid saved index, otherwise counted in a
+// single pass over the data without building or saving the index
+uint64_t row_index_rows(const std::string& fileName, const char* data, uint64_t size,
+						uint64_t dataOffset);
+
+
+#endif // ROW_INDEX_H
@@ -0,0 +1,58 @@
+#include "rtt.h"
+
+
+static uint64_t clamp(const RttEstimator* rtt, uint64_t us)
+{
+	if (us < rtt->min)
+		return rtt->min;
+
+	if (us > rtt->max)
+		return rtt->max;
+
+	return us;
+}
+
+
+void rtt_init(RttEstimator* rtt, uint64_t usInitial, uint64_t usMin, uint64_t usMax)
+{
+	rtt->srtt = 0;
+	rtt->rttvar = 0;
+	rtt->min = usMin;
+	rtt->max = usMax;
+	rtt->samples = 0;
+	rtt->rto = clamp(rtt, usInitial);
+}
+
+
+void rtt_sample(RttEstimator* rtt, uint64_t us)
+{
+	if (rtt->samples++ == 0)
+	{
+		rtt->srtt = us;
+		rtt->rttvar = us / 2;
+	}
+	else
+	{
+		const uint64_t delta = us > rtt->srtt ? us - rtt->srtt : rtt->srtt - us;
+
+		rtt->rttvar = (3 * rtt->rttvar + delta) / 4;
+		rtt->srtt = (7 * rtt->srtt + us) / 8;
+	}
+
+	// On a steady link deviation tends to zero, the minimum is kept as
+	// slack over the mean to absorb jitter (as Linux does)
+	const uint64_t slack = 4 * rtt->rttvar > rtt->min ? 4 * rtt->rttvar : rtt->min;
+
+	rtt->rto = clamp(rtt, rtt->srtt + slack);
+}
+
+
+uint64_t rtt_timeout(const RttEstimator* rtt, uint32_t retries)
+{
+	uint64_t us = rtt->rto;
+
+	for (uint32_t i = 0; i < retries && us < rtt->max; i++)
+		us *= 2;
+
+	return clamp(rtt, us);
+}
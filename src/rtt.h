@@ -0,0 +1,33 @@
+#ifndef RTT_H
+#define RTT_H
+
+#include <stdint.h>
+
+
+//
+// Answer timeout derived from measured round trip times, as TCP does
+// (RFC 6298): smoothed mean plus four mean deviations (at least the
+// minimum timeout), clamped.
+// Only answers to packets sent once are measured (Karn's algorithm).
+//
+typedef struct
+{
+	uint64_t srtt;          // Smoothed round trip time, us
+	uint64_t rttvar;        // Its mean deviation, us
+	uint64_t rto;           // Timeout for the first transmission, us
+	uint64_t min;
+	uint64_t max;
+	uint64_t samples;
+}
+RttEstimator;
+
+
+void rtt_init(RttEstimator* rtt, uint64_t usInitial, uint64_t usMin, uint64_t usMax);
+void rtt_sample(RttEstimator* rtt, uint64_t us);
+
+// Timeout for a packet already retransmitted `retries` times: doubled
+// with every retry, up to the maximum
+uint64_t rtt_timeout(const RttEstimator* rtt, uint32_t retries);
+
+
+#endif // RTT_H
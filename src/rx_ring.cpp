@@ -0,0 +1,47 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "rx_ring.h"
+
+
+uint8_t rx_ring_init(RxRing* ring, uint32_t size)
+{
+	memset(ring, 0, sizeof(RxRing));
+
+	ring->data = (uint8_t*) malloc(size);
+	ring->size = ring->data ? size : 0;
+
+	return ring->data != NULL ? 0 : 1;
+}
+
+
+void rx_ring_free(RxRing* ring)
+{
+	free(ring->data);
+	memset(ring, 0, sizeof(RxRing));
+}
+
+
+uv_buf_t rx_ring_space(RxRing* ring)
+{
+	// Incomplete frame is never longer than the parser buffer, moving
+	// it is cheaper than splitting frames across the wrap
+	if (ring->head && ring->size - ring->tail < ring->size / 2)
+	{
+		memmove(ring->data, ring->data + ring->head, ring->tail - ring->head);
+		ring->tail -= ring->head;
+		ring->head = 0;
+	}
+
+	return uv_buf_init((char*) ring->data + ring->tail, ring->size - ring->tail);
+}
+
+
+void rx_ring_commit(RxRing* ring, Parser* parser, uint32_t count)
+{
+	ring->tail += count;
+	ring->head += parser_scan(parser, ring->data + ring->head, ring->tail - ring->head);
+
+	if (ring->head == ring->tail)
+		ring->head = ring->tail = 0;
+}
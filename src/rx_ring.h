@@ -0,0 +1,38 @@
+#ifndef RX_RING_H
+#define RX_RING_H
+
+#include <stdint.h>
+#include <uv.h>
+
+#include "parser.h"
+
+
+//
+// Persistent receive buffer of a connection. Reads go straight into it
+// and frames are parsed in place; an incomplete frame left at the end
+// wraps around to the start (it is moved there) once the free space at
+// the end runs out, so every frame stays contiguous.
+//
+typedef struct
+{
+	uint8_t* data;
+	uint32_t size;
+	uint32_t head;          // First byte not parsed yet
+	uint32_t tail;          // End of received data
+}
+RxRing;
+
+
+// `size` should cover the largest read plus the largest frame
+uint8_t rx_ring_init(RxRing* ring, uint32_t size);
+void rx_ring_free(RxRing* ring);
+
+// Free space to read into
+uv_buf_t rx_ring_space(RxRing* ring);
+
+// Accounts `count` bytes read into rx_ring_space() and hands complete
+// frames to the parser
+void rx_ring_commit(RxRing* ring, Parser* parser, uint32_t count);
+
+
+#endif // RX_RING_H
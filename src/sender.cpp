@@ -1,19 +1,23 @@
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <netdb.h>
+#include <arpa/inet.h>
 
 #include "protocol.h"
 #include "sender.h"
 #include "sender_fsm.h"
 #include "parser.h"
-#include "simple_csv.h"
+#include "dataset.h"
+#include "serial_baud.h"
+#include "shard.h"
 
 
-static int sender_read(Sender* sender);
-
-static Sender* instance = NULL;
-
-
-static int set_interface_attribs(int fd, int speed, int parity, int stop)
+static int set_interface_attribs(int fd, uint32_t baud, uint8_t flowControl, int parity, int stop,
+								 uint32_t* actualBaud)
 {
 	struct termios tty;
 	memset (&tty, 0, sizeof tty);
@@ -21,9 +25,6 @@ static int set_interface_attribs(int fd, int speed, int parity, int stop)
 	if (tcgetattr (fd, &tty) != 0)
 		return -1;
 
-	cfsetospeed (&tty, speed);
-	cfsetispeed (&tty, speed);
-
 	tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8;     // 8-bit chars
 	// disable IGNBRK for mismatched speed tests; otherwise receive break
 	// as \000 chars
@@ -44,12 +45,14 @@ static int set_interface_attribs(int fd, int speed, int parity, int stop)
 	tty.c_cflag |= parity;
 	if (stop) tty.c_cflag |= CSTOPB;
 	else tty.c_cflag &= ~CSTOPB;
-	tty.c_cflag &= ~CRTSCTS;
+	if (flowControl) tty.c_cflag |= CRTSCTS;
+	else tty.c_cflag &= ~CRTSCTS;
 
 	if (tcsetattr (fd, TCSANOW, &tty) != 0)
 		return -1;
 
-	return 0;
+	// Any integer rate, not just B* constants
+	return serial_set_baud(fd, baud, actualBaud);
 }
 
 
@@ -68,15 +71,99 @@ static void set_blocking(int fd, uint8_t vmin, uint8_t vtime)
 }
 
 
-static void on_valid_packet(void* data, uint32_t size)
+static void on_valid_packet(void* ctx, void* data, uint32_t size)
 {
 	PacketHeader* hdr = (PacketHeader*) data;
-	sender_fsm(instance, NULL, hdr, size);
+	sender_fsm((Sender*) ctx, NULL, hdr, size);
+}
+
+
+//
+// Resolves device endpoint: "address", "address:port", "[address]:port"
+// for IPv6 or a bare IPv6 address. Host names are looked up as well.
+//
+static int resolve_endpoint(uv_loop_t* loop, const char* endpoint, int defaultPort,
+							struct sockaddr_storage* addr)
+{
+	char host[256];
+	const char* port = NULL;
+	const char* colon = strrchr(endpoint, ':');
+	size_t len = strlen(endpoint);
+
+	if (endpoint[0] == '[')
+	{
+		const char* close = strchr(endpoint, ']');
+		if (!close || (close[1] != '\0' && close[1] != ':'))
+			return 1;
+
+		endpoint++;
+		len = close - endpoint;
+		port = close[1] == ':' ? close + 2 : NULL;
+	}
+	else if (colon && colon == strchr(endpoint, ':'))
+	{
+		// Single colon separates the port, more of them make an IPv6 address
+		len = colon - endpoint;
+		port = colon + 1;
+	}
+
+	if (len == 0 || len >= sizeof(host))
+		return 1;
+
+	memcpy(host, endpoint, len);
+	host[len] = '\0';
+
+	char service[16];
+	if (!port)
+	{
+		snprintf(service, sizeof(service), "%d", defaultPort);
+		port = service;
+	}
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	uv_getaddrinfo_t req;
+	if (0 != uv_getaddrinfo(loop, &req, NULL, host, port, &hints))
+		return 2;
+
+	memset(addr, 0, sizeof(*addr));
+	memcpy(addr, req.addrinfo->ai_addr, req.addrinfo->ai_addrlen);
+	uv_freeaddrinfo(req.addrinfo);
+
+	return 0;
+}
+
+
+static inline socklen_t addr_size(const struct sockaddr_storage* addr)
+{
+	return addr->ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+}
+
+
+// Answers from a loopback device are received on loopback only, as before;
+// from any other device on all interfaces of its address family
+static void local_endpoint(const struct sockaddr_storage* remote, int port, struct sockaddr_storage* local)
+{
+	memset(local, 0, sizeof(*local));
+
+	if (remote->ss_family == AF_INET6)
+	{
+		const uint8_t loopback = IN6_IS_ADDR_LOOPBACK(&((const struct sockaddr_in6*) remote)->sin6_addr);
+		uv_ip6_addr(loopback ? "::1" : "::", port, (struct sockaddr_in6*) local);
+	}
+	else
+	{
+		const uint8_t loopback = (ntohl(((const struct sockaddr_in*) remote)->sin_addr.s_addr) >> 24) == 127;
+		uv_ip4_addr(loopback ? "127.0.0.1" : "0.0.0.0", port, (struct sockaddr_in*) local);
+	}
 }
 
 
-static int sender_init_uv_handles(Sender* sender, uint8_t isUdp, int bindPort, int sendPort,
-								  const char* serial, int speed)
+static int sender_init_uv_handles(Sender* sender, uint8_t isUdp, const char* host, int bindPort, int sendPort,
+								  const char* serial, uint32_t baud, uint8_t flowControl)
 {
 	uv_timer_t* timer = (uv_timer_t*) calloc(1, sizeof(uv_timer_t));
 	if (!timer)
@@ -84,7 +171,7 @@ static int sender_init_uv_handles(Sender* sender, uint8_t isUdp, int bindPort, i
 
 	sender->timer = timer;
 	sender->timer->data = sender;
-	if (0 != uv_timer_init(uv_default_loop(), timer))
+	if (0 != uv_timer_init(sender->loop, timer))
 	{
 		fprintf(stderr, "Failed to init timer\n");
 		return 2;
@@ -100,16 +187,36 @@ static int sender_init_uv_handles(Sender* sender, uint8_t isUdp, int bindPort, i
 
 		sender->socket = sock;
 		sender->socket->data = sender;
-		if (0 != uv_udp_init(uv_default_loop(), sock))
+
+#if UV_VERSION_HEX >= 0x012500
+		// Replies are drained with recvmmsg() where the platform has it
+		const int res = uv_udp_init_ex(sender->loop, sock, AF_UNSPEC | UV_UDP_RECVMMSG);
+#else
+		const int res = uv_udp_init(sender->loop, sock);
+#endif
+		if (0 != res)
 		{
 			fprintf(stderr, "Failed to init socket\n");
 			return 4;
 		}
 
-		uv_ip4_addr("127.0.0.1", sendPort, &sender->addr);
+		sender->flush = (uv_prepare_t*) calloc(1, sizeof(uv_prepare_t));
+		sender->tx.bufs = (uv_buf_t*) calloc(SENDER_TX_QUEUE, sizeof(uv_buf_t));
+		if (!sender->flush || !sender->tx.bufs)
+			return 3;
+
+		sender->tx.capacity = SENDER_TX_QUEUE;
+		sender->flush->data = sender;
+		uv_prepare_init(sender->loop, sender->flush);
 
-		struct sockaddr_in addr;
-		uv_ip4_addr("127.0.0.1", bindPort, &addr);
+		if (0 != resolve_endpoint(sender->loop, host, sendPort, &sender->addr))
+		{
+			fprintf(stderr, "Failed to resolve device address %s\n", host);
+			return 5;
+		}
+
+		struct sockaddr_storage addr;
+		local_endpoint(&sender->addr, bindPort, &addr);
 		if (0 != uv_udp_bind(sock, (const struct sockaddr*) &addr, 0))
 		{
 			fprintf(stderr, "Failed to bind port %u\n", bindPort);
@@ -119,7 +226,7 @@ static int sender_init_uv_handles(Sender* sender, uint8_t isUdp, int bindPort, i
 	else
 	{
 		uv_fs_t open_req = { 0 };
-		int fd = sender->fd = uv_fs_open(uv_default_loop(), &open_req, serial, UV_FS_O_NOCTTY | UV_FS_O_RDWR, 0, NULL);
+		int fd = sender->fd = uv_fs_open(sender->loop, &open_req, serial, UV_FS_O_NOCTTY | UV_FS_O_RDWR, 0, NULL);
 		if (0 > fd)
 		{
 			fprintf(stderr, "Failed to open %s: %s\n", serial, uv_strerror(fd));
@@ -127,48 +234,203 @@ static int sender_init_uv_handles(Sender* sender, uint8_t isUdp, int bindPort, i
 		}
 
 		set_blocking(fd, 0, 0);
-		set_interface_attribs(fd, speed, 0, 1);
+
+		// Driven by readiness on the loop thread, not by threadpool requests
+		if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+		{
+			fprintf(stderr, "Failed to set %s non-blocking\n", serial);
+			return 3;
+		}
+
+		uint32_t actualBaud = 0;
+		if (0 != set_interface_attribs(fd, baud, flowControl, 0, 1, &actualBaud))
+		{
+			fprintf(stderr, "Failed to set %u baud on %s\n", baud, serial);
+			return 8;
+		}
+
+		fprintf(stderr, "Serial port %s: %u baud (requested %u)%s\n", serial, actualBaud, baud,
+				flowControl ? ", RTS/CTS flow control" : "");
+
+		sender->baud = actualBaud;
+
+		sender->poll = (uv_poll_t*) calloc(1, sizeof(uv_poll_t));
+		sender->tx.bufs = (uv_buf_t*) calloc(SENDER_TX_QUEUE, sizeof(uv_buf_t));
+		if (!sender->poll || !sender->tx.bufs)
+			return 3;
+
+		sender->tx.capacity = SENDER_TX_QUEUE;
+		sender->poll->data = sender;
+		if (0 != uv_poll_init(sender->loop, sender->poll, fd))
+		{
+			fprintf(stderr, "Failed to poll %s\n", serial);
+			return 3;
+		}
 	}
 
-	if (0 != parser_init(on_valid_packet))
+	if (0 != parser_init(&sender->parser, on_valid_packet, sender))
 	{
 		fprintf(stderr, "Failed to init parser\n");
 		return 6;
 	}
 
+	// Room for a batch of whole datagrams (libuv reads each into its own
+	// 64 KB) or a serial read, plus an incomplete frame carried over
+	const uint32_t rxSize = (isUdp ? 2 * SENDER_UDP_RX_DATAGRAMS * 64 * 1024 : 16 * 1024) +
+							parser_buffer_size(&sender->parser);
+
+	sender->rxAllocations++;
+	if (0 != rx_ring_init(&sender->rx, rxSize))
+	{
+		fprintf(stderr, "Failed to allocate recv buffer\n");
+		return 7;
+	}
+
 	return 0;
 }
 
 
-Sender* sender_create(uint8_t isUdp, const char* dataset, int bindPort, int sendPort,
-					  const char* serial, int speed)
+uint64_t sender_rows_total(const SenderConfig* config, DatasetReader* reader, const PacketCache* cache)
+{
+	uint64_t rows = 0;
+
+	if (cache)
+		rows = cache->header.packetsCount;
+	else
+	{
+		try
+		{
+			rows = reader->Rows();
+		}
+		catch (std::exception& e)
+		{
+			fprintf(stderr, "Failed to count dataset rows: %s\n", e.what());
+			return 0;
+		}
+	}
+
+	if (config->endRow && config->endRow < rows)
+		rows = config->endRow;
+
+	return rows > config->startRow ? rows - config->startRow : 0;
+}
+
+
+static int progress_init(Sender* sender, const SenderConfig* config)
 {
-	SimpleCsvReader *csvReader;
+	Progress* progress = &sender->progress;
+
+	progress->timer = (uv_timer_t*) calloc(1, sizeof(uv_timer_t));
+	if (!progress->timer)
+		return 1;
+
+	progress->timer->data = sender;
+	progress->interval = config->progress * 1000;
+	progress->name = config->isUdp ? (config->host ? config->host : "127.0.0.1") : config->serial;
+
+	return uv_timer_init(sender->loop, progress->timer);
+}
+
+
+//
+// Status line of the upload: rates since the previous line, ETA from the
+// average rate since the start. Serial link use counts 10 bits per byte
+// (start, 8 data, stop). With shared rows the ETA is for all devices.
+//
+static void progress_on_timer(uv_timer_t* handle)
+{
+	Sender* sender = (Sender*) handle->data;
+	Progress* progress = &sender->progress;
+
+	const uint64_t now = uv_hrtime() / 1000;
+	if (sender->state != STATE_SEND_SAMPLES || now <= progress->lastAt)
+		return;
+
+	const double seconds = (now - progress->lastAt) / 1e6;
+	const double samples = (sender->samplesAnswered - progress->lastSamples) / seconds;
+	const double tx = (sender->txBytes - progress->lastTxBytes) / seconds;
+	const double rx = (sender->rxBytes - progress->lastRxBytes) / seconds;
+
+	progress->lastAt = now;
+	progress->lastSamples = sender->samplesAnswered;
+	progress->lastTxBytes = sender->txBytes;
+	progress->lastRxBytes = sender->rxBytes;
+
+	const uint64_t done = sender->shard ? sender->shard->printedRow - sender->startRow : sender->samplesAnswered;
+
+	char rows[64];
+	if (progress->rows)
+		snprintf(rows, sizeof(rows), "%llu/%llu rows (%.1f%%)", (unsigned long long) done,
+				 (unsigned long long) progress->rows, 100.0 * done / progress->rows);
+	else
+		snprintf(rows, sizeof(rows), "%llu rows", (unsigned long long) done);
+
+	char link[96];
+	if (sender->baud)
+		snprintf(link, sizeof(link), "link tx %.0f%% rx %.0f%% of %u baud",
+				 100.0 * tx * 10 / sender->baud, 100.0 * rx * 10 / sender->baud, sender->baud);
+	else
+		snprintf(link, sizeof(link), "link tx %.1f KB/s rx %.1f KB/s", tx / 1024, rx / 1024);
+
+	char eta[32] = "-";
+	if (progress->rows && done && now > sender->startedAt)
+	{
+		const uint64_t left = done < progress->rows ? progress->rows - done : 0;
+		const uint64_t s = (uint64_t) (left * ((now - sender->startedAt) / 1e6) / done);
+
+		snprintf(eta, sizeof(eta), "%llu:%02u:%02u", (unsigned long long) (s / 3600),
+				 (unsigned) (s / 60 % 60), (unsigned) (s % 60));
+	}
+
+	fprintf(stderr, "Progress %s: %s, %.0f samples/s, %.1f KB/s payload, %s, %llu retries, ETA %s\n",
+			progress->name, rows, samples, samples * sender->sampleSize / 1024, link,
+			(unsigned long long) (sender->retransmits + sender->window.retransmits), eta);
+}
+
+
+Sender* sender_create(const SenderConfig* config)
+{
+	DatasetReader *reader = NULL;
 
 	try 
 	{
-		csvReader = new SimpleCsvReader(dataset);
+		// Shared rows are read by the shard
+		if (!config->shard)
+			reader = dataset_open(config->dataset, config->parseThreads);
 	}
-	catch (std::exception&)
+	catch (std::exception& e)
 	{
-		fprintf(stderr, "File not found: %s\n", dataset);
+		fprintf(stderr, "Failed to open dataset: %s\n", e.what());
 		return NULL;
 	}
 
 	Sender* sender = (Sender*) calloc(1, sizeof(Sender));
 	if (!sender)
+	{
+		delete reader;
 		return NULL;
+	}
+
+	sender->dataset = reader;
+	sender->loop = config->loop ? config->loop : uv_default_loop();
 
-	if (0 != sender_init_uv_handles(sender, isUdp, bindPort, sendPort, serial, speed))
+	sender->out = config->output ? config->output : stdout;
+
+	if (0 != sender_init_uv_handles(sender, config->isUdp, config->host ? config->host : "127.0.0.1",
+									config->bindPort, config->sendPort,
+									config->serial, config->baud, config->flowControl))
 	{
 		sender_destroy(sender);
+		free(sender);
 		return NULL;
 	}
 
-	sender->csvReader = csvReader;
+	sender->shard = config->shard;
+	sender->trace = trace_log_loop(config->trace);
+	sender->device = config->device;
 
-	auto header = csvReader->GetParcedLine<std::string>();
-	if (!header.size())
+	const uint32_t columns = reader ? reader->Columns() : config->shard->columnsInSample - 1;
+	if (!columns)
 	{
 		fprintf(stderr, "Nothing to send: empty file\n");
 		sender_destroy(sender);
@@ -176,7 +438,7 @@ Sender* sender_create(uint8_t isUdp, const char* dataset, int bindPort, int send
 		return NULL;
 	}
 
-	sender->columnsInSample = header.size() + 1;
+	sender->columnsInSample = columns + 1;
 	sender->sampleSize = (sender->columnsInSample) * sizeof(float);
 	sender->sample = (float*) calloc(sender->columnsInSample, sizeof(float));
 	if (!sender->sample)
@@ -187,6 +449,111 @@ Sender* sender_create(uint8_t isUdp, const char* dataset, int bindPort, int send
 		return NULL;
 	}
 
+	sender->startRow = config->startRow;
+	sender->endRow = config->endRow;
+	sender->windowRequested = config->window;
+
+	// Samples and dataset info are the largest packets built; a few spare
+	// entries cover the control packets and the request being retried
+	const uint32_t payloadSize = sender->sampleSize > sizeof(DatasetInfo) + sizeof(DatasetOptions) ?
+								 sender->sampleSize : sizeof(DatasetInfo) + sizeof(DatasetOptions);
+	const uint32_t poolSize = (config->window < SENDER_MAX_WINDOW ? config->window : SENDER_MAX_WINDOW) + 4;
+
+	if (0 != tx_pool_init(&sender->txPool, poolSize, sizeof(PacketHeader) + payloadSize + sizeof(uint16_t)))
+	{
+		fprintf(stderr, "Failed to allocate send buffers\n");
+		sender_destroy(sender);
+		free(sender);
+		return NULL;
+	}
+
+	sender->batchRequested = config->batch;
+	sender->maxRetries = config->maxRetries;
+
+	if (config->progress && 0 != progress_init(sender, config))
+	{
+		fprintf(stderr, "Failed to init progress timer\n");
+		sender_destroy(sender);
+		free(sender);
+		return NULL;
+	}
+
+	// Until the first answer, timeouts start at the old fixed value
+	for (uint32_t i = 0; i < STATE_SHUTDOWN; i++)
+		rtt_init(&sender->rtt[i], SENDER_INITIAL_TIMEOUT * 1000ull,
+				 config->rtoMin * 1000ull, config->rtoMax * 1000ull);
+
+	if (sender->shard)
+	{
+		sender->progress.rows = sender->shard->rows;
+		return sender;
+	}
+
+	if (config->packetCache)
+	{
+		sender->packetCache = packet_cache_open(config->packetCache, reader, sender->columnsInSample);
+		if (!sender->packetCache)
+		{
+			fprintf(stderr, "Failed to open packet cache\n");
+			sender_destroy(sender);
+			free(sender);
+			return NULL;
+		}
+
+		// Packets are fixed size, the cache is indexed directly
+		if (sender->startRow > sender->packetCache->header.packetsCount)
+		{
+			fprintf(stderr, "Start row is out of range (%llu rows)\n",
+					(unsigned long long) sender->packetCache->header.packetsCount);
+			sender_destroy(sender);
+			free(sender);
+			return NULL;
+		}
+
+		if (config->progress)
+			sender->progress.rows = sender_rows_total(config, NULL, sender->packetCache);
+
+		return sender;
+	}
+
+	// Counted before the read-ahead thread takes the reader
+	if (config->progress)
+		sender->progress.rows = sender_rows_total(config, reader, NULL);
+
+	if (sender->startRow)
+	{
+		try
+		{
+			reader->Seek(sender->startRow);
+		}
+		catch (std::exception& e)
+		{
+			fprintf(stderr, "Failed to seek dataset: %s\n", e.what());
+			sender_destroy(sender);
+			free(sender);
+			return NULL;
+		}
+	}
+
+	if (config->readAhead)
+	{
+		sender->readAhead = new ReadAhead(reader, config->readAhead);
+		if (config->trace)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "read-ahead %u", config->device);
+			sender->readAhead->SetTrace(trace_log_ring(config->trace, name), config->device);
+		}
+
+		if (!sender->readAhead->Start())
+		{
+			fprintf(stderr, "Failed to start read-ahead thread\n");
+			sender_destroy(sender);
+			free(sender);
+			return NULL;
+		}
+	}
+
 	return sender;
 
 err:
@@ -208,14 +575,43 @@ void sender_destroy(Sender* sender)
 	if (sender->timer)
 		free(sender->timer);
 
+	if (sender->progress.timer)
+		free(sender->progress.timer);
+
 	if (sender->socket)
 		free(sender->socket);
 
+	if (sender->poll)
+		free(sender->poll);
+
+	if (sender->flush)
+		free(sender->flush);
+
+	// Whatever didn't make it to the port
+	for (; sender->tx.count; sender->tx.count--, sender->tx.head = (sender->tx.head + 1) % sender->tx.capacity)
+		sender_release_buffers(sender, &sender->tx.bufs[sender->tx.head], 1);
+
+	if (sender->tx.bufs)
+		free(sender->tx.bufs);
+
 	if (sender->sample)
 		free(sender->sample);
+
+	if (sender->window.slots)
+		free(sender->window.slots);
+
+	if (sender->readAhead)
+		delete sender->readAhead;
+
+	if (sender->packetCache)
+		packet_cache_close(sender->packetCache);
 		
-	if (sender->csvReader)
-		delete sender->csvReader;
+	if (sender->dataset)
+		delete sender->dataset;
+
+	parser_free(&sender->parser);
+	rx_ring_free(&sender->rx);
+	tx_pool_free(&sender->txPool);
 
 	memset(sender, 0, sizeof(Sender));
 }
@@ -224,38 +620,72 @@ void sender_destroy(Sender* sender)
 static void sender_on_recv(uv_udp_t* handle, ssize_t nRead, const uv_buf_t* buffer,
 						   const struct sockaddr* addr, unsigned flags)
 {
-	if (nRead <= 0 || !buffer)
-		goto _free;
+	Sender* sender = (Sender*) handle->data;
 
-	for (ssize_t i = 0; i < nRead; i++)
-		parser_parse(buffer->base[i]);
+	if (nRead <= 0)
+		return;
 
-_free:
+	// Datagram was read in place into the ring. recvmmsg() puts every
+	// datagram of a batch into its own chunk, each one is moved right
+	// after the previous so frames stay contiguous.
+	uint8_t* tail = sender->rx.data + sender->rx.tail;
+	if ((uint8_t*) buffer->base != tail)
+		memmove(tail, buffer->base, nRead);
 
-	if (buffer && buffer->base)
-		free(buffer->base);
+	sender->rxBytes += nRead;
+	rx_ring_commit(&sender->rx, &sender->parser, nRead);
 }
 
 
-uint8_t sender_read_sample(Sender* sender)
+uint8_t sender_read_sample(Sender* sender, float* sample)
 {
 	if (!sender)
 		return 0;
 
-	auto values = sender->csvReader->GetParcedLine<float>();
-	if (values.size() == 0)
+	if (sender->shard)
+	{
+		if (!shard_read(sender->shard, sample, &sender->row))
+			return 0;
+
+		sender->samplesRead++;
+		return 1;
+	}
+
+	if (sender->endRow && sender->startRow + sender->samplesRead >= sender->endRow)
 		return 0;
 
-	if (sender->columnsInSample != (values.size() + 1))
+	if (sender->packetCache)
+	{
+		if (sender->startRow + sender->samplesRead >= sender->packetCache->header.packetsCount)
+			return 0;
+
+		sender->row = sender->startRow + sender->samplesRead++;
+		return 1;
+	}
+
+	const uint32_t columns = sender->columnsInSample - 1;
+
+	int res;
+	if (sender->readAhead)
+		res = sender->readAhead->Pop(sample);
+	else
+	{
+		const uint64_t traceAt = trace_now(sender->trace);
+		res = sender->dataset->ReadRow(sample);
+		trace_span(sender->trace, TRACE_PARSE, NULL, sender->device, traceAt, 1);
+	}
+
+	if (res == 0)
+		return 0;
+
+	if (res < 0)
 	{
 		fprintf(stderr, "%s: failed to read sample\n", __func__);
 		return 0;
 	}
 
-	for (uint32_t i = 0; i < values.size(); ++i)
-		sender->sample[i] = values[i];
-	
-	sender->sample[values.size()] = 1.0;
+	sample[columns] = 1.0;
+	sender->row = sender->startRow + sender->samplesRead++;
 
 	return 1;
 }
@@ -263,92 +693,337 @@ uint8_t sender_read_sample(Sender* sender)
 
 static void sender_alloc_rx_buffer(uv_handle_t* handle, size_t requestedSize, uv_buf_t* buffer)
 {
-	if (!buffer)
-		return;
+	Sender* sender = (Sender*) handle->data;
+
+	*buffer = rx_ring_space(&sender->rx);
+}
+
 
-	buffer->base = (char*) calloc(1, requestedSize);
-	buffer->len =requestedSize;
+static void serial_set_events(Sender* sender, int events);
 
-	if (!buffer->base)
+
+// Reads everything available straight into the receive ring
+static void serial_read(Sender* sender)
+{
+	for (;;)
 	{
-		fprintf(stderr, "Failed to allocate recv buffer\n");
-		memset(buffer, 0, sizeof(uv_buf_t));
+		uv_buf_t buf = rx_ring_space(&sender->rx);
+
+		ssize_t res = read(sender->fd, buf.base, buf.len);
+		if (res > 0)
+		{
+			sender->rxBytes += res;
+			rx_ring_commit(&sender->rx, &sender->parser, res);
+
+			// Port is closed once the sender is finished
+			if (sender->fd <= 0)
+				return;
+
+			continue;
+		}
+
+		if (res < 0 && errno == EINTR)
+			continue;
+
+		// No more data: non-blocking read gives EAGAIN, VMIN = 0 gives 0
+		if (res == 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+			return;
+
+		fprintf(stderr, "%s: %s\n", __func__, strerror(errno));
+		sender_finish(sender);
+		return;
 	}
 }
 
 
-static void sender_fs_read(uv_fs_t *req)
+//
+// Writes all queued packets with as few writev() calls as the port
+// takes, packets queued during one loop iteration go out together
+//
+static void serial_flush(Sender* sender)
 {
-	Sender* sender = (Sender*) req->data;
-	ssize_t result = req->result;
+	TxQueue* tx = &sender->tx;
+	struct iovec iov[64];
 
-	if (result > 0)
+	while (tx->count)
 	{
-		for (ssize_t i = 0; i < result; i++)
-			parser_parse(req->bufsml[0].base[i]);
+		uint32_t n = 0;
+		for (; n < tx->count && n < sizeof(iov) / sizeof(iov[0]); n++)
+		{
+			const uv_buf_t* buf = &tx->bufs[(tx->head + n) % tx->capacity];
+			const size_t skip = n ? 0 : tx->offset;
+
+			iov[n].iov_base = buf->base + skip;
+			iov[n].iov_len = buf->len - skip;
+		}
+
+		const uint64_t traceAt = trace_now(sender->trace);
+
+		ssize_t res = writev(sender->fd, iov, n);
+		trace_span(sender->trace, TRACE_WRITE, "writev", sender->device, traceAt, res > 0 ? res : 0);
+
+		if (res < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			fprintf(stderr, "%s: %s\n", __func__, strerror(errno));
+			sender_finish(sender);
+			return;
+		}
+
+		size_t written = res;
+
+		while (written && tx->count)
+		{
+			uv_buf_t* buf = &tx->bufs[tx->head];
+			const size_t left = buf->len - tx->offset;
+
+			if (written < left)
+			{
+				tx->offset += written;
+				break;
+			}
+
+			written -= left;
+
+			uv_buf_t done = *buf;
+			tx->head = (tx->head + 1) % tx->capacity;
+			tx->count--;
+			tx->offset = 0;
+
+			// May queue the next packets right away
+			sender_release_buffers(sender, &done, 1);
+			if (sender->fd <= 0)
+				return;
+		}
+
+		// Port buffer is full
+		if (tx->offset)
+			break;
 	}
 
-	for (uint32_t i = 0; i < (sizeof(req->bufsml) / sizeof(req->bufsml[0])); i++)
-		if (req->bufsml[i].base)
-			free(req->bufsml[i].base);
+	serial_set_events(sender, tx->count ? UV_READABLE | UV_WRITABLE : UV_READABLE);
+}
 
-	free(req);
 
-	if (result < 0)
-		return;
+static void serial_on_poll(uv_poll_t* handle, int status, int events)
+{
+	Sender* sender = (Sender*) handle->data;
 
-	if (0 != sender_read(sender))
+	if (status < 0)
 	{
-		fprintf(stderr, "%s: failed to read serial port\n", __func__);
+		fprintf(stderr, "%s: %s\n", __func__, uv_strerror(status));
 		sender_finish(sender);
+		return;
 	}
 
-	return;
+	if (events & UV_READABLE)
+		serial_read(sender);
+
+	if ((events & UV_WRITABLE) && sender->fd > 0)
+		serial_flush(sender);
+}
+
+
+static void serial_set_events(Sender* sender, int events)
+{
+	if (sender->pollEvents == events)
+		return;
+
+	sender->pollEvents = events;
+	uv_poll_start(sender->poll, events, serial_on_poll);
+}
+
+
+// Queues packet to be written once the port is writable
+uint8_t sender_serial_send(Sender* sender, uv_buf_t buffer)
+{
+	TxQueue* tx = &sender->tx;
+
+	if (sender->fd <= 0 || tx->count == tx->capacity)
+		return 0;
+
+	tx->bufs[(tx->head + tx->count) % tx->capacity] = buffer;
+	tx->count++;
+
+	serial_set_events(sender, UV_READABLE | UV_WRITABLE);
+
+	return 1;
 }
 
 
-static int sender_read(Sender* sender)
+static void udp_send_cb(uv_udp_send_t* req, int status)
 {
-	uv_buf_t buf;
-	sender_alloc_rx_buffer(NULL, 2048, &buf);
-	if (!buf.base)
+	Sender* sender = (Sender*) req->data;
+
+	if (0 != status)
 	{
-		fprintf(stderr, "Failed to allocate recv buffer\n");
+		fprintf(stderr, "%s: status %d\n", __func__, status);
 		sender_finish(sender);
-		return 1;
+		return;
 	}
 
-	uv_fs_t* req = (uv_fs_t*) calloc(1, sizeof(uv_fs_t));
-	if (!req)
+	sender_release_buffers(sender, req->bufsml, sizeof(req->bufsml) / sizeof(req->bufsml[0]));
+
+	tx_pool_release_request(&sender->txPool, req);
+}
+
+
+// Takes the oldest queued datagram
+static uv_buf_t udp_pop(TxQueue* tx)
+{
+	uv_buf_t buf = tx->bufs[tx->head];
+
+	tx->head = (tx->head + 1) % tx->capacity;
+	tx->count--;
+
+	return buf;
+}
+
+
+//
+// Sends all datagrams queued during the loop iteration with as few
+// sendmmsg() calls as the socket takes. The rest waits in libuv's send
+// queue for the socket to drain, and so do the next ones, in order.
+//
+static void udp_flush(Sender* sender)
+{
+	TxQueue* tx = &sender->tx;
+
+#if defined(__linux__)
+	uv_os_fd_t fd;
+	if (0 != uv_fileno((uv_handle_t*) sender->socket, &fd))
+		fd = -1;
+
+	while (tx->count && fd >= 0 && sender->socket->send_queue_count == 0)
 	{
-		fprintf(stderr, "Failed to allocate read request\n");
-		sender_finish(sender);
-		return 2;
-	}
+		struct mmsghdr msgs[64];
+		struct iovec iov[64];
+		uint32_t n = 0;
 
-	req->data = sender;
+		for (; n < tx->count && n < sizeof(msgs) / sizeof(msgs[0]); n++)
+		{
+			const uv_buf_t* buf = &tx->bufs[(tx->head + n) % tx->capacity];
 
-	int res = uv_fs_read(uv_default_loop(), req, sender->fd, &buf, 1, -1, sender_fs_read);
-	if (0 != res)
+			iov[n].iov_base = buf->base;
+			iov[n].iov_len = buf->len;
+
+			memset(&msgs[n], 0, sizeof(msgs[n]));
+			msgs[n].msg_hdr.msg_name = &sender->addr;
+			msgs[n].msg_hdr.msg_namelen = addr_size(&sender->addr);
+			msgs[n].msg_hdr.msg_iov = &iov[n];
+			msgs[n].msg_hdr.msg_iovlen = 1;
+		}
+
+		const uint64_t traceAt = trace_now(sender->trace);
+
+		int res = sendmmsg(fd, msgs, n, 0);
+		if (sender->trace)
+		{
+			uint32_t bytes = 0;
+			for (int i = 0; i < res; i++)
+				bytes += iov[i].iov_len;
+
+			trace_span(sender->trace, TRACE_WRITE, "sendmmsg", sender->device, traceAt, bytes);
+		}
+
+		if (res < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			fprintf(stderr, "%s: %s\n", __func__, strerror(errno));
+			sender_finish(sender);
+			return;
+		}
+
+		for (int i = 0; i < res; i++)
+		{
+			uv_buf_t done = udp_pop(tx);
+
+			// May queue the next packets right away. Receiving stops once
+			// the sender is finished, nothing else keeps the socket active here.
+			sender_release_buffers(sender, &done, 1);
+			if (!uv_is_active((uv_handle_t*) sender->socket))
+				return;
+		}
+	}
+#endif
+
+	while (tx->count)
 	{
-		fprintf(stderr, "%s: %s\n", __func__, uv_strerror(res));
-		sender_finish(sender);
-		return 3;
+		uv_buf_t buf = udp_pop(tx);
+
+		uv_udp_send_t* req = tx_pool_request(&sender->txPool);
+		if (!req)
+		{
+			fprintf(stderr, "%s: failed to alloc udp request\n", __func__);
+			sender_release_buffers(sender, &buf, 1);
+			sender_finish(sender);
+			return;
+		}
+
+		req->data = sender;
+
+		// Tried right away, queued by libuv when the socket is busy
+		const uint64_t traceAt = trace_now(sender->trace);
+		const int res = uv_udp_send(req, sender->socket, &buf, 1, (const struct sockaddr*) &sender->addr, udp_send_cb);
+		trace_span(sender->trace, TRACE_WRITE, "uv_udp_send", sender->device, traceAt, buf.len);
+
+		if (0 != res)
+		{
+			fprintf(stderr, "%s: failed to send packet\n", __func__);
+			tx_pool_release_request(&sender->txPool, req);
+			sender_release_buffers(sender, &buf, 1);
+			sender_finish(sender);
+			return;
+		}
 	}
 
-	sender->read_request = req;
+	uv_prepare_stop(sender->flush);
+}
+
 
-	return 0;
+static void udp_on_prepare(uv_prepare_t* handle)
+{
+	udp_flush((Sender*) handle->data);
 }
 
 
-int sender_run(Sender* sender, uint32_t delay)
+// Queues datagram to be sent before the loop waits for events again
+uint8_t sender_udp_send(Sender* sender, uv_buf_t buffer)
+{
+	TxQueue* tx = &sender->tx;
+
+	if (tx->count == tx->capacity)
+		return 0;
+
+	tx->bufs[(tx->head + tx->count) % tx->capacity] = buffer;
+	tx->count++;
+
+	// Stop-and-wait has nothing to batch, the request goes out right away
+	if (sender->window.slots)
+		uv_prepare_start(sender->flush, udp_on_prepare);
+	else
+		udp_flush(sender);
+
+	return 1;
+}
+
+
+int sender_start(Sender* sender, uint32_t delay)
 {
 	if (!sender)
 		return 1;
 
 	sender->error = 1;
-	instance = sender;
 
 	if (sender->isUdp)
 	{
@@ -360,20 +1035,42 @@ int sender_run(Sender* sender, uint32_t delay)
 	}
 	else
 	{
-		if (0 != sender_read(sender))
+		serial_set_events(sender, UV_READABLE);
+		if (!uv_is_active((uv_handle_t*) sender->poll))
+		{
+			fprintf(stderr, "Failed to start serial port polling\n");
 			return 3;
+		}
 	}
 
 	sender->retries = 0;
-	sender->maxRetries = 3;
+	sender->startedAt = uv_hrtime() / 1000 + delay * 1000ull;
+	sender->finishedAt = 0;
+
+	// Doesn't keep the loop running on its own
+	if (sender->progress.timer)
+	{
+		sender->progress.lastAt = sender->startedAt;
+		uv_timer_start(sender->progress.timer, progress_on_timer,
+					   sender->progress.interval + delay, sender->progress.interval);
+		uv_unref((uv_handle_t*) sender->progress.timer);
+	}
 
 	state_transition_delayed(sender, STATE_GET_MODEL_INFO, delay);
 
 	sender->error = 0;
 
+	return 0;
+}
+
 
+int sender_run(Sender* sender, uint32_t delay)
+{
+	int res = sender_start(sender, delay);
+	if (0 != res)
+		return res;
 
-	return uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+	return uv_run(sender->loop, UV_RUN_DEFAULT);
 }
 
 void sender_finish(Sender* sender)
@@ -381,24 +1078,47 @@ void sender_finish(Sender* sender)
 	if (!sender)
 		return;
 
+	if (sender->startedAt && !sender->finishedAt)
+		sender->finishedAt = uv_hrtime() / 1000;
+
 	if (sender->timer)
 	{
 		uv_timer_stop(sender->timer);
 		uv_unref((uv_handle_t*) sender->timer);
 	}
 
+	if (sender->progress.timer)
+		uv_timer_stop(sender->progress.timer);
+
+	if (sender->flush)
+		uv_prepare_stop(sender->flush);
+
 	if (sender->socket)
 	{
 		uv_udp_recv_stop(sender->socket);
 		uv_unref((uv_handle_t*) sender->socket);
 	}
 
+	if (sender->poll)
+	{
+		uv_poll_stop(sender->poll);
+		uv_unref((uv_handle_t*) sender->poll);
+		sender->pollEvents = 0;
+	}
+
 	if (sender->fd > 0)
 	{
 		uv_fs_t req = { 0 };
-		uv_fs_close(uv_default_loop(), &req, sender->fd, NULL);
+		uv_fs_close(sender->loop, &req, sender->fd, NULL);
+		sender->fd = 0;
 	}
 
 	if (sender->state != STATE_SHUTDOWN)
+	{
 		sender->error = 1;
+
+		// Rows taken by a failed device would never be answered
+		if (sender->shard)
+			sender->shard->failed = 1;
+	}
 }
@@ -5,7 +5,15 @@
 #include <stdint.h>
 #include <uv.h>
 
-#include "simple_csv.h"
+#include "dataset.h"
+#include "read_ahead.h"
+#include "packet_cache.h"
+#include "parser.h"
+#include "rx_ring.h"
+#include "tx_pool.h"
+#include "rtt.h"
+#include "histogram.h"
+#include "trace.h"
 
 
 typedef enum
@@ -19,39 +27,195 @@ typedef enum
 SenderState;
 
 
+#define SENDER_MAX_WINDOW       (1024)
+#define SENDER_INITIAL_TIMEOUT  (2000)      // ms
+#define SENDER_TX_QUEUE         (SENDER_MAX_WINDOW + 4)
+#define SENDER_UDP_RX_DATAGRAMS (8)         // Received with a single recvmmsg()
+
+
+typedef struct Shard Shard;
+
+
+typedef struct
+{
+	float*   result;                // Answers waiting for the older packets
+	uint64_t row;                   // Dataset row of the first sample
+	uint64_t sentAt;                // Time of the last transmission, us
+	uint64_t timeout;               // Its answer timeout, us
+	uint32_t retries;
+	uint32_t samples;               // Samples in the packet
+	uint8_t  answered;
+	uint8_t  hasResult;
+	uint8_t  pending;               // Transmissions not completed yet
+}
+WindowSlot;
+
+
+//
+// Packets in flight when pipelining or batches are negotiated: a ring of
+// slots in sequence order, the oldest at `head` has sequence number
+// `baseSeq`. Every packet carries up to `batch` samples.
+//
 typedef struct
 {
+	WindowSlot* slots;              // NULL - stop-and-wait
+	uint32_t    size;
+	uint32_t    head;
+	uint32_t    count;
+	uint32_t    batch;              // 1 - TYPE_DATASET_SAMPLE packets
+	uint16_t    baseSeq;
+	uint8_t     exhausted;          // No more samples to read
+	uint8_t     blocked;            // Next slot still being transmitted
+	uint8_t*    packets;            // Slot packets kept for retransmits
+	uint32_t    packetSize;
+	uint32_t    packetStride;
+	uint64_t    timerDue;           // Earliest answer deadline, us
+	uint64_t    retransmits;
+}
+SendWindow;
+
+
+//
+// Packets waiting for the serial port, written with a single writev()
+// once it is writable, or datagrams sent together with sendmmsg() at
+// the end of the loop iteration
+//
+typedef struct
+{
+	uv_buf_t* bufs;
+	uint32_t  capacity;
+	uint32_t  head;
+	uint32_t  count;
+	size_t    offset;               // Bytes of the first packet already written
+}
+TxQueue;
+
+
+//
+// Periodic status line: rates since the previous one, counters are
+// updated on the way and only read here
+//
+typedef struct
+{
+	uv_timer_t* timer;              // NULL - off
+	uint32_t    interval;           // ms
+	const char* name;               // Device
+	uint64_t    rows;               // Rows to send, 0 - unknown
+	uint64_t    lastAt;             // Previous status line, us
+	uint64_t    lastSamples;
+	uint64_t    lastTxBytes;
+	uint64_t    lastRxBytes;
+}
+Progress;
+
+
+typedef struct
+{
+	uv_loop_t* loop;
 	uv_timer_t* timer;
 	uv_udp_t* socket;
+	uv_prepare_t* flush;            // Sends queued datagrams before the loop blocks
 	int fd;
-	uv_fs_t* read_request;
-	struct sockaddr_in addr;
+	uv_poll_t* poll;                // Serial port readiness
+	int pollEvents;
+	TxQueue tx;
+	struct sockaddr_storage addr;   // Device address
 
 	SenderState state;
 	uint32_t sampleSent;
 	uint32_t retries;
 	uint32_t maxRetries;
+	uint64_t sentAt;                // Time of the last request, us
+	RttEstimator rtt[STATE_SHUTDOWN];   // Answer times per state
+	Histogram roundTrip;            // Sample answer times, us, per sample
 	float*   sample;
 	uint32_t sampleSize;
 	uint32_t error;
 
-	SimpleCsvReader *csvReader;
+	DatasetReader *dataset;
+	ReadAhead *readAhead;
+	PacketCache *packetCache;
+	uint64_t samplesRead;
+	uint64_t row;                   // Dataset row of the last sample read
+	Shard*   shard;                 // Rows shared with other senders, NULL - own dataset
+	uint64_t startRow;
+	uint64_t endRow;
+
+	uint32_t windowRequested;
+	uint32_t batchRequested;
+	SendWindow window;
+
+	Parser   parser;
+	RxRing   rx;
+	uint32_t resultHeaderPrinted;
+	FILE*    out;                   // Results
+
+	TxPool   txPool;                // Packets and requests in flight
+	uint64_t rxAllocations;         // Buffers/requests allocated for I/O
 
 	uint32_t columnsInSample;
 	uint32_t columnsInResult;
 	uint32_t taskType;
 
 	uint32_t isUdp;
+
+	uint64_t startedAt;             // Upload time span, us
+	uint64_t finishedAt;
+
+	uint32_t baud;                  // Serial port rate, 0 - UDP
+	uint64_t samplesAnswered;
+	uint64_t txBytes;               // Bytes queued and received
+	uint64_t rxBytes;
+	uint64_t retransmits;           // Requests sent again outside of the window
+	Progress progress;
+
+	Trace*   trace;                 // Loop thread spans, NULL - off
+	uint32_t device;                // Index in the devices list
+	uint64_t transitionAt;          // Pending state transition, ns (traced only)
 }
 Sender;
 
 
-Sender* sender_create(uint8_t isUdp, const char* dataset,
-					  int bindPort, int sendPort,
-					  const char* serial, int speed);
+typedef struct
+{
+	uv_loop_t*  loop;           // NULL - default loop
+	uint8_t     isUdp;
+	const char* dataset;
+	const char* host;           // Device "address[:port]", IPv6 in brackets with port
+	int         bindPort;
+	int         sendPort;       // Used when `host` has no port
+	const char* serial;
+	uint32_t    baud;
+	uint8_t     flowControl;    // RTS/CTS hardware flow control
+	uint32_t    readAhead;      // Samples parsed ahead (0 - off)
+	uint32_t    parseThreads;   // CSV parser threads (0 - one per CPU core)
+	const char* packetCache;    // Packet cache file, NULL - off
+	uint64_t    startRow;       // First dataset row to send
+	uint64_t    endRow;         // Row to stop before, 0 - end of dataset
+	uint32_t    window;         // Packets in flight to negotiate (1 - stop-and-wait)
+	uint32_t    batch;          // Samples per packet (0 - as many as fit)
+	uint32_t    maxRetries;     // Retransmissions before giving up
+	uint32_t    rtoMin;         // Answer timeout range, ms
+	uint32_t    rtoMax;
+	FILE*       output;         // Results, NULL - stdout
+	Shard*      shard;          // Rows shared with other senders, NULL - own dataset
+	uint32_t    progress;       // Status line interval, s (0 - off)
+	TraceLog*   trace;          // Timeline spans, NULL - off
+	uint32_t    device;         // Index in the devices list, for the trace
+}
+SenderConfig;
+
+
+Sender* sender_create(const SenderConfig* config);
 void sender_destroy(Sender *sender);
+// Starts upload on sender's loop, any number of senders can share one loop
+int sender_start(Sender* sender, uint32_t delay);
+// Starts upload and runs the loop until it's done
 int sender_run(Sender* sender, uint32_t delay);
 void sender_finish(Sender* sender);
 
+// Rows `config` selects from the dataset or cache, 0 - unknown
+uint64_t sender_rows_total(const SenderConfig* config, DatasetReader* reader, const PacketCache* cache);
+
 
 #endif // SENDER_H
@@ -4,151 +4,237 @@
 #include "sender_fsm.h"
 #include "checksum.h"
 #include "protocol.h"
+#include "shard.h"
 
 
-uint8_t sender_read_sample(Sender* sender);
+uint8_t sender_read_sample(Sender* sender, float* sample);
+uint8_t sender_serial_send(Sender* sender, uv_buf_t buffer);
+uint8_t sender_udp_send(Sender* sender, uv_buf_t buffer);
 
 
-static uv_buf_t alloc_buffer(Sender* sender)
+static inline uint64_t now_us()
 {
-	const size_t size = sender->sampleSize + sizeof(uint16_t) + sizeof(PacketHeader);
-	uv_buf_t buffer;
+	return uv_hrtime() / 1000;
+}
+
 
-	buffer.base = (char*) calloc(1, size);
-	buffer.len = buffer.base ? size : 0;
+// Answer timeout of a packet sent in the current state, us
+static uint64_t answer_timeout(Sender* sender, uint32_t retries)
+{
+#if defined(SENDER_SIMULATE_PACKETS)
+	return 0;
+#else
+	return rtt_timeout(&sender->rtt[sender->state], retries);
+#endif
+}
+
+
+//
+// Timeout of a stop-and-wait request. Those carry no sequence number: a
+// late answer to a retransmitted one would be taken for the answer to
+// the next request, so the adaptive timeout is only ever raised above
+// the fixed one, never lowered.
+//
+static uint64_t request_timeout(Sender* sender, uint32_t retries)
+{
+	const uint64_t us = answer_timeout(sender, retries);
 
-	if (buffer.len == 0)
+#if defined(SENDER_SIMULATE_PACKETS)
+	return us;
+#else
+	return us > SENDER_INITIAL_TIMEOUT * 1000ull ? us : SENDER_INITIAL_TIMEOUT * 1000ull;
+#endif
+}
+
+
+// Answer type expected in the current state of stop-and-wait exchange
+static uint8_t request_answer_type(const Sender* sender)
+{
+	switch (sender->state)
 	{
-		fprintf(stderr, "Failed to allocate send buffer\n");
-		sender_finish(sender);
+	case STATE_GET_MODEL_INFO:
+		return TYPE_MODEL_INFO;
+	case STATE_SEND_DATASET_INFO:
+		return TYPE_DATASET_INFO;
+	case STATE_SEND_SAMPLES:
+		return TYPE_DATASET_SAMPLE;
+	case STATE_GET_PERFORMANCE_COUNTERS:
+		return TYPE_PERF_REPORT;
+	default:
+		return TYPE_ERROR;
 	}
+}
 
-	return buffer;
+
+static inline uint64_t us_to_ms(uint64_t us)
+{
+	return (us + 999) / 1000;
 }
 
 
-static void make_packet(Sender* sender, uv_buf_t* buffer, size_t size, PacketType type, ErrorCode err)
+//
+// Builds a complete packet in one pass: the payload is copied into a new
+// buffer and checksummed on the way. Returns empty buffer on failure.
+//
+static uv_buf_t build_packet(Sender* sender, PacketType type, ErrorCode err, const void* payload, uint32_t size)
 {
-	if (!buffer && buffer->len < sizeof(PacketHeader) && buffer->base == NULL)
+	const uint64_t traceAt = trace_now(sender->trace);
+	const size_t total = sizeof(PacketHeader) + size + sizeof(uint16_t);
+	uv_buf_t buffer;
+
+	buffer.base = NULL;
+	buffer.len = 0;
+
+	if (total > UINT16_MAX)
 	{
-		fprintf(stderr, "%s: invalid buffer\n", __func__);
+		fprintf(stderr, "%s: packet too big: %zu\n", __func__, total);
 		sender_finish(sender);
-		return;
+		return buffer;
+	}
+
+	buffer.base = (char*) tx_pool_buffer(&sender->txPool, total);
+	if (!buffer.base)
+	{
+		fprintf(stderr, "Failed to allocate send buffer\n");
+		sender_finish(sender);
+		return buffer;
 	}
 
-	PacketHeader* hdr = (PacketHeader*) buffer->base;
+	buffer.len = total;
+
+	PacketHeader* hdr = (PacketHeader*) buffer.base;
 
 	hdr->preamble = PREAMBLE;
+	hdr->size = total;
 	hdr->type = type;
 	hdr->error = err;
-	hdr->size = sizeof(PacketHeader) + size + sizeof(uint16_t);
+	hdr->reserved[0] = 0;
+	hdr->reserved[1] = 0;
 
-	if (hdr->size > buffer->len)
-	{
-		fprintf(stderr, "%s: buffer too small: requested %u actual %zu\n", __func__, hdr->size, buffer->len);
-		sender_finish(sender);
-		return;
-	}
+	uint16_t crc = crc16_table((uint8_t*) hdr, sizeof(PacketHeader), 0);
+	crc = crc16_copy((uint8_t*) (hdr + 1), (const uint8_t*) payload, size, crc);
+	memcpy(buffer.base + total - sizeof(uint16_t), &crc, sizeof(uint16_t));
 
-	buffer->len = hdr->size;
+	trace_span(sender->trace, TRACE_BUILD, NULL, sender->device, traceAt, total);
 
-	uint16_t crc = crc16_table((uint8_t*) hdr, hdr->size - sizeof(uint16_t), 0);
-	memcpy(buffer->base + hdr->size - sizeof(uint16_t), &crc, sizeof(uint16_t));
+	return buffer;
 }
 
 
+static const char* state_to_str(uint8_t err);
+
+
 static void sender_onTimer(uv_timer_t* handle)
 {
 	Sender* sender = (Sender*) handle->data;
+	const uint64_t traceAt = trace_now(sender->trace);
+	const char* state = sender->trace ? state_to_str(sender->state) : NULL;
+
+	// Transitions re-enter the fsm through the timer
+	if (sender->transitionAt)
+	{
+		trace_record(sender->trace, TRACE_STATE, state, sender->device, sender->transitionAt, traceAt, 0);
+		sender->transitionAt = 0;
+	}
+
 	sender_fsm(sender, handle, NULL, 0);
+
+	trace_span(sender->trace, TRACE_TIMER, state, sender->device, traceAt, 0);
 }
 
 
-static void sender_send_cb(uv_udp_send_t* req, int status)
+static void window_pump(Sender* sender);
+
+
+static inline uint8_t* window_packet(const SendWindow* w, uint32_t index)
 {
-	if (0 != status)
-	{
-		fprintf(stderr, "%s: status %d\n", __func__, status);
-		sender_finish((Sender*) req->data);
-		return;
-	}
+	return w->packets + (size_t) index * w->packetStride;
+}
 
-	for (uint32_t i = 0; i < (sizeof(req->bufsml) / sizeof(req->bufsml[0])); i++)
-		if (req->bufsml[i].base)
-			free(req->bufsml[i].base);
 
-	free(req);
+static inline uint8_t window_owns(const SendWindow* w, const void* ptr)
+{
+	return w->packets && (const uint8_t*) ptr >= w->packets &&
+		   (const uint8_t*) ptr < w->packets + (size_t) w->size * w->packetStride;
 }
 
 
-static void sender_fs_sent(uv_fs_t *req)
+static void window_sent(Sender* sender, const void* packet)
 {
-	int code = req->result;
+	SendWindow* w = &sender->window;
+	WindowSlot* slot = &w->slots[((const uint8_t*) packet - w->packets) / w->packetStride];
 
-	for (uint32_t i = 0; i < (sizeof(req->bufsml) / sizeof(req->bufsml[0])); i++)
-		if (req->bufsml[i].base)
-			free(req->bufsml[i].base);
+	slot->pending--;
+
+	// Slot can take the next sample now
+	if (w->blocked && !slot->pending && !sender->error && sender->state == STATE_SEND_SAMPLES)
+		window_pump(sender);
+}
 
-	free(req);
 
-	if (0 > code)
+void sender_release_buffers(Sender* sender, uv_buf_t* bufs, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		// Packets sent straight from the packet cache are not owned
+		if (!bufs[i].base || packet_cache_owns(sender->packetCache, bufs[i].base))
+			continue;
+
+		// Window slots are reused
+		if (window_owns(&sender->window, bufs[i].base))
+			window_sent(sender, bufs[i].base);
+		else
+			tx_pool_release_buffer(&sender->txPool, bufs[i].base);
+	}
+}
+
+
+// Queues packet for sending, returns 0 on failure
+static uint8_t transmit(Sender* sender, uv_buf_t buffer)
+{
+	const uint8_t queued = sender->isUdp ? sender_udp_send(sender, buffer)
+										 : sender_serial_send(sender, buffer);
+	if (!queued)
 	{
-		Sender* sender = (Sender*) req->data;
 		fprintf(stderr, "%s: failed to send packet\n", __func__);
 		sender_finish(sender);
-		return;
+		return 0;
 	}
 
-	return;
+	sender->txBytes += buffer.len;
+
+	return 1;
 }
 
 
+// Sends request of the current state, sender->retries - 1 times sent before
 static void send_packet(Sender* sender, uv_buf_t buffer)
 {
-	if (sender->isUdp)
-	{
-		uv_udp_send_t* req = (uv_udp_send_t*) calloc(1, sizeof(uv_udp_send_t));
-		if (!req)
-		{
-			fprintf(stderr, "%s: failed to alloc udp request\n", __func__);
-			sender_finish(sender);
-			return;
-		}
-		if (0 != uv_udp_send(req, sender->socket, &buffer, 1,
-							(const struct sockaddr*) &sender->addr, sender_send_cb))
-		{
-			fprintf(stderr, "%s: failed to send packet\n", __func__);
-			sender_finish(sender);
-			return;
-		}
-	}
-	else
-	{
-		uv_fs_t* req = (uv_fs_t*) calloc(1, sizeof(uv_fs_t));
-		if (!req)
-		{
-			fprintf(stderr, "%s: failed to alloc fs request\n", __func__);
-			sender_finish(sender);
-			return;
-		}
+	sender->sentAt = now_us();
 
-		req->data = sender;
+	if (sender->retries > 1)
+		sender->retransmits++;
 
-		if (0 != uv_fs_write(uv_default_loop(), req, sender->fd, &buffer, 1, -1, sender_fs_sent))
-		{
-			fprintf(stderr, "%s: failed to send packet\n", __func__);
-			sender_finish(sender);
-			return;
-		}
-	}
+	if (transmit(sender, buffer))
+		uv_timer_start(sender->timer, sender_onTimer, us_to_ms(request_timeout(sender, sender->retries - 1)), 0);
+}
 
-#if defined(SENDER_SIMULATE_PACKETS)
-	const uint32_t timeout = 0;
-#else
-	const uint32_t timeout = 2000;
-#endif
 
-	uv_timer_start(sender->timer, sender_onTimer, timeout, 0);
+// Answer to the request of the current state arrived
+static void answer_received(Sender* sender)
+{
+	// Answer to a retransmitted request can't be told from the late one
+	if (sender->retries == 1)
+	{
+		const uint64_t elapsed = now_us() - sender->sentAt;
+
+		rtt_sample(&sender->rtt[sender->state], elapsed);
+		if (sender->state == STATE_SEND_SAMPLES)
+			histogram_record(&sender->roundTrip, elapsed, 1);
+	}
+
+	if (sender->trace)
+		trace_span(sender->trace, TRACE_WAIT, state_to_str(sender->state), sender->device, sender->sentAt * 1000, 1);
 }
 
 
@@ -235,15 +321,10 @@ static PacketHeader* check_packet(void* buffer, size_t size)
 
 	PacketHeader *hdr = (PacketHeader*) buffer;
 
+	// CRC is already verified by the parser
 	if (hdr->preamble != PREAMBLE || hdr->size > size)
 		return NULL;
 
-	uint16_t crc_packet;
-	memcpy(&crc_packet, (uint8_t*) hdr + hdr->size - sizeof(uint16_t), sizeof(uint16_t));
-
-	if (crc_packet != crc16_table((uint8_t*) hdr, hdr->size - sizeof(uint16_t), 0))
-		return NULL;
-
 	if (!IS_ANS(hdr->type))
 		return NULL;
 
@@ -256,6 +337,7 @@ void state_transition(Sender* sender, SenderState state)
 	sender->state = state;
 	sender->retries = 0;
 	sender->sampleSent = 0;
+	sender->transitionAt = trace_now(sender->trace);
 	uv_timer_start(sender->timer, sender_onTimer, 0, 0);
 }
 
@@ -265,6 +347,7 @@ void state_transition_delayed(Sender* sender, SenderState state, uint32_t delay)
 	sender->state = state;
 	sender->retries = 0;
 	sender->sampleSent = 0;
+	sender->transitionAt = trace_now(sender->trace);
 	uv_timer_start(sender->timer, sender_onTimer, delay, 0);
 }
 
@@ -307,6 +390,455 @@ static const char* state_to_str(uint8_t err)
 }
 
 
+void sender_print_result(Sender* sender, const float* result)
+{
+	// Senders sharing rows print a single table
+	uint32_t* headerPrinted = sender->shard ? &sender->shard->headerPrinted : &sender->resultHeaderPrinted;
+
+	if (!*headerPrinted)
+	{
+		*headerPrinted = 1;
+		
+		if (sender->taskType == 2)
+		{
+			if (sender->columnsInResult == 1)
+			{
+				fprintf(sender->out, "target\n");
+			}
+			else
+			{
+				for (uint16_t i = 0; i < sender->columnsInResult; ++i)
+				{
+					fprintf(sender->out, "Predicted value for output #%u%s",
+							i + 1, (i + 1) < sender->columnsInResult ? "," : "");
+				}
+				fprintf(sender->out, "\n");
+			}
+		}
+		else
+		{
+			fprintf(sender->out, "target%s", sender->columnsInResult > 1 ? "," : "");
+			for (uint16_t i = 0; i < sender->columnsInResult; ++i)
+			{
+				fprintf(sender->out, "Probability of %d%s",
+						i, (i + 1) < sender->columnsInResult ? "," : "");
+			}
+			fprintf(sender->out, "\n");
+		}
+	}
+
+	if (sender->taskType < 2)
+	{
+		uint32_t index = 0;
+		float max = 0;
+		for (uint32_t i = 0; i < sender->columnsInResult; i++)
+		{
+			if (max < result[i])
+			{
+				index = i;
+				max = result[i];
+			}
+		}
+			
+		fprintf(sender->out, "%u,", index);
+	}
+
+	for (uint32_t i = 0; i < sender->columnsInResult; i++)
+		fprintf(sender->out, "%.6f%s", result[i], (i+1) < sender->columnsInResult ? "," : "");
+	fprintf(sender->out, "\n");
+}
+
+
+// Results of `count` samples from dataset row `row` on, NULL - answered without results
+static void deliver_results(Sender* sender, uint64_t row, const float* results, uint32_t count)
+{
+	sender->samplesAnswered += count;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const float* result = results ? results + i * sender->columnsInResult : NULL;
+
+		if (sender->shard)
+			shard_result(sender->shard, sender, row + i, result);
+		else if (result)
+			sender_print_result(sender, result);
+	}
+}
+
+
+static void samples_done(Sender* sender)
+{
+	if (sender->readAhead)
+		fprintf(stderr, "Read-ahead: waited for parser %llu times\n",
+				(unsigned long long) sender->readAhead->Stalls());
+
+	const RttEstimator* rtt = &sender->rtt[STATE_SEND_SAMPLES];
+	fprintf(stderr, "Answer time: avg %.2f ms, deviation %.2f ms, timeout %.2f ms\n",
+			rtt->srtt / 1000.0, rtt->rttvar / 1000.0,
+			(sender->window.slots ? rtt->rto : request_timeout(sender, 0)) / 1000.0);
+
+	if (sender->window.slots)
+		fprintf(stderr, "Window: %u packets in flight, %u samples per packet, %llu retransmitted\n",
+				sender->window.size, sender->window.batch, (unsigned long long) sender->window.retransmits);
+
+	fprintf(stderr, "I/O allocations: rx %llu, tx %llu for %llu samples\n",
+			(unsigned long long) sender->rxAllocations,
+			(unsigned long long) sender->txPool.heapAllocations,
+			(unsigned long long) sender->samplesRead);
+
+	fprintf(stderr, "================\n");
+	state_transition(sender, STATE_GET_PERFORMANCE_COUNTERS);
+}
+
+
+//
+// Host side counterpart of the device's sample calc time: from sending a
+// sample to its answer, including the link and both ends' overhead.
+// Samples of a batch share the packet's time.
+//
+static void print_round_trip(const Sender* sender)
+{
+	const Histogram* h = &sender->roundTrip;
+
+	if (!h->total)
+		return;
+
+	fprintf(stderr,
+			"Round trip report (%llu samples, retransmitted ones excluded):\n"
+			"Sample round trip, p50:   %llu us\n"
+			"Sample round trip, p90:   %llu us\n"
+			"Sample round trip, p99:   %llu us\n"
+			"Sample round trip, p99.9: %llu us\n"
+			"Sample round trip, max:   %llu us\n"
+			"================\n",
+			(unsigned long long) h->total,
+			(unsigned long long) histogram_percentile(h, 50.0),
+			(unsigned long long) histogram_percentile(h, 90.0),
+			(unsigned long long) histogram_percentile(h, 99.0),
+			(unsigned long long) histogram_percentile(h, 99.9),
+			(unsigned long long) h->max);
+}
+
+
+// Pipelining or batches requested, DatasetOptions to be negotiated
+static inline uint8_t wants_options(const Sender* sender)
+{
+	return sender->windowRequested > 1 || sender->batchRequested != 1;
+}
+
+
+//
+// Samples per TYPE_DATASET_BATCH packet: as many as the requested count,
+// the device's receive buffer and our parser (for the answer) allow
+//
+static uint32_t batch_size(Sender* sender, uint32_t deviceBufferSize)
+{
+	const uint32_t overhead = sizeof(PacketHeader) + sizeof(DatasetBatch) + sizeof(uint16_t);
+	const uint32_t resultSize = sender->columnsInResult * sizeof(float);
+	const uint32_t hostBufferSize = parser_buffer_size(&sender->parser);
+
+	uint32_t batch = sender->batchRequested ? sender->batchRequested : UINT16_MAX;
+
+	if (deviceBufferSize > UINT16_MAX)
+		deviceBufferSize = UINT16_MAX;
+
+	if (deviceBufferSize < overhead || hostBufferSize < overhead)
+		return 1;
+
+	if (batch > (deviceBufferSize - overhead) / sender->sampleSize)
+		batch = (deviceBufferSize - overhead) / sender->sampleSize;
+
+	if (batch > (hostBufferSize - overhead) / resultSize)
+		batch = (hostBufferSize - overhead) / resultSize;
+
+	return batch ? batch : 1;
+}
+
+
+static inline uint32_t packet_overhead(const SendWindow* w)
+{
+	return sizeof(PacketHeader) + (w->batch > 1 ? sizeof(DatasetBatch) : 0) + sizeof(uint16_t);
+}
+
+
+// Samples of a window packet, parsed straight in place
+static inline float* window_samples(const SendWindow* w, uint32_t index)
+{
+	return (float*) (window_packet(w, index) + packet_overhead(w) - sizeof(uint16_t));
+}
+
+
+//
+// Slots with their packets and answers in a single allocation
+//
+static uint8_t window_init(Sender* sender, uint32_t size, uint32_t batch)
+{
+	SendWindow* w = &sender->window;
+
+	w->batch = batch;
+
+	const size_t resultSize = batch * sender->columnsInResult * sizeof(float);
+	const uint32_t packetSize = packet_overhead(w) + batch * sender->sampleSize;
+	const uint32_t packetStride = (packetSize + 7) & ~7u;
+
+	uint8_t* data = (uint8_t*) calloc(size, sizeof(WindowSlot) + resultSize + packetStride);
+	if (!data)
+		return 0;
+
+	w->slots = (WindowSlot*) data;
+	w->packets = data + size * (sizeof(WindowSlot) + resultSize);
+	w->packetSize = packetSize;
+	w->packetStride = packetStride;
+	w->size = size;
+
+	for (uint32_t i = 0; i < size; i++)
+		w->slots[i].result = (float*) (data + size * sizeof(WindowSlot) + i * resultSize);
+
+	return 1;
+}
+
+
+static void window_send(Sender* sender, uint32_t index)
+{
+	SendWindow* w = &sender->window;
+	WindowSlot* slot = &w->slots[index];
+
+	uv_buf_t buf;
+	buf.base = (char*) window_packet(w, index);
+	buf.len = ((PacketHeader*) buf.base)->size;
+
+	slot->sentAt = now_us();
+	slot->timeout = answer_timeout(sender, slot->retries);
+	if (!transmit(sender, buf))
+		return;
+
+	slot->pending++;
+
+	// Timer is kept at the earliest deadline
+	const uint64_t deadline = slot->sentAt + slot->timeout;
+	if (!uv_is_active((uv_handle_t*) sender->timer) || deadline < w->timerDue)
+	{
+		w->timerDue = deadline;
+		uv_timer_start(sender->timer, sender_onTimer, us_to_ms(slot->timeout), 0);
+	}
+}
+
+
+//
+// Reads up to w->batch samples into the slot's packet, then fills in the
+// header and crc. Returns number of samples read.
+//
+static uint32_t window_fill(Sender* sender, uint32_t index, uint16_t seq)
+{
+	SendWindow* w = &sender->window;
+	float* samples = window_samples(w, index);
+	uint32_t count = 0;
+
+	for (; count < w->batch; count++, samples += sender->columnsInSample)
+	{
+		if (0 == sender_read_sample(sender, samples))
+		{
+			w->exhausted = 1;
+			break;
+		}
+
+		// Rows of one packet are read in a row, shared ones as well
+		if (!count)
+			w->slots[index].row = sender->row;
+
+		if (sender->packetCache)
+			memcpy(samples, packet_cache_packet(sender->packetCache, sender->row) +
+					sizeof(PacketHeader), sender->sampleSize);
+	}
+
+	if (!count)
+		return 0;
+
+	uint8_t* packet = window_packet(w, index);
+	PacketHeader* hdr = (PacketHeader*) packet;
+	const uint32_t total = packet_overhead(w) + count * sender->sampleSize;
+
+	hdr->preamble = PREAMBLE;
+	hdr->size = total;
+	hdr->type = w->batch > 1 ? TYPE_DATASET_BATCH : TYPE_DATASET_SAMPLE;
+	hdr->error = ERROR_SUCCESS;
+	hdr->reserved[0] = seq & 0xFF;
+	hdr->reserved[1] = seq >> 8;
+
+	if (w->batch > 1)
+	{
+		DatasetBatch* batch = (DatasetBatch*) (hdr + 1);
+		batch->count = count;
+		batch->reserved = 0;
+	}
+
+	const uint16_t crc = crc16_table(packet, total - sizeof(uint16_t), 0);
+	memcpy(packet + total - sizeof(uint16_t), &crc, sizeof(uint16_t));
+
+	return count;
+}
+
+
+//
+// Fills free slots with the next samples and sends them. A slot whose
+// previous packet is still being written waits for its send callback.
+//
+static void window_pump(Sender* sender)
+{
+	SendWindow* w = &sender->window;
+
+	w->blocked = 0;
+
+	while (!w->exhausted && w->count < w->size)
+	{
+		const uint32_t index = (w->head + w->count) % w->size;
+		WindowSlot* slot = &w->slots[index];
+
+		if (slot->pending)
+		{
+			w->blocked = 1;
+			break;
+		}
+
+		const uint64_t traceAt = trace_now(sender->trace);
+
+		slot->samples = window_fill(sender, index, (uint16_t) (w->baseSeq + w->count));
+		if (!slot->samples)
+			break;
+
+		if (sender->trace)
+			trace_span(sender->trace, TRACE_BUILD, NULL, sender->device, traceAt,
+					   ((const PacketHeader*) window_packet(w, index))->size);
+
+		slot->retries = 0;
+		slot->answered = 0;
+		slot->hasResult = 0;
+		w->count++;
+
+		window_send(sender, index);
+		if (sender->error)
+			return;
+	}
+
+	if (w->exhausted && !w->count)
+	{
+		// Other devices may have taken all the shared rows
+		if (!sender->samplesRead && !sender->shard)
+		{
+			fprintf(stderr, "%s: failed to read sample\n", __func__);
+			sender_finish(sender);
+			return;
+		}
+
+		samples_done(sender);
+		return;
+	}
+}
+
+
+// Answers may come in any order, results are printed in dataset order
+static void window_on_answer(Sender* sender, PacketHeader* hdr, const void* payload, uint32_t payloadSize)
+{
+	SendWindow* w = &sender->window;
+
+	// Duplicate answer to a retransmitted sample
+	const uint16_t offset = packet_seq(hdr) - w->baseSeq;
+	if (offset >= w->count)
+		return;
+
+	WindowSlot* slot = &w->slots[(w->head + offset) % w->size];
+	if (slot->answered)
+		return;
+
+	const uint8_t* results = (const uint8_t*) payload;
+	uint32_t resultsSize = sizeof(float) * sender->columnsInResult;
+
+	if (w->batch > 1)
+	{
+		const DatasetBatch* batch = (const DatasetBatch*) payload;
+
+		// Results of a batch come all or none
+		if (payloadSize < sizeof(DatasetBatch) || batch->count != slot->samples)
+			payloadSize = 0;
+
+		results += sizeof(DatasetBatch);
+		resultsSize *= slot->samples;
+		payloadSize -= payloadSize ? sizeof(DatasetBatch) : 0;
+	}
+
+	if (!slot->retries)
+	{
+		const uint64_t elapsed = now_us() - slot->sentAt;
+
+		rtt_sample(&sender->rtt[sender->state], elapsed);
+		histogram_record(&sender->roundTrip, elapsed, slot->samples);
+	}
+
+	if (sender->trace)
+		trace_span(sender->trace, TRACE_WAIT, state_to_str(sender->state), sender->device,
+				   slot->sentAt * 1000, slot->samples);
+
+	slot->answered = 1;
+	slot->hasResult = payloadSize >= resultsSize;
+	if (slot->hasResult)
+		memcpy(slot->result, results, resultsSize);
+
+	while (w->count && w->slots[w->head].answered)
+	{
+		slot = &w->slots[w->head];
+		deliver_results(sender, slot->row, slot->hasResult ? slot->result : NULL, slot->samples);
+
+		w->head = (w->head + 1) % w->size;
+		w->baseSeq++;
+		w->count--;
+	}
+
+	window_pump(sender);
+}
+
+
+// Retransmits the samples not answered in time
+static void window_on_timer(Sender* sender)
+{
+	SendWindow* w = &sender->window;
+	const uint64_t now = now_us();
+	uint64_t next = UINT64_MAX;
+
+	for (uint32_t i = 0; i < w->count; i++)
+	{
+		const uint32_t index = (w->head + i) % w->size;
+		WindowSlot* slot = &w->slots[index];
+
+		if (slot->answered)
+			continue;
+
+		if (slot->sentAt + slot->timeout <= now)
+		{
+			if (++slot->retries > sender->maxRetries)
+			{
+				fprintf(stderr, "%s: timeout sending sample(s)\n", __func__);
+				sender_finish(sender);
+				return;
+			}
+
+			w->retransmits++;
+			window_send(sender, index);
+			if (sender->error)
+				return;
+		}
+
+		if (next > slot->sentAt + slot->timeout)
+			next = slot->sentAt + slot->timeout;
+	}
+
+	if (next != UINT64_MAX)
+	{
+		w->timerDue = next;
+		uv_timer_start(sender->timer, sender_onTimer, us_to_ms(next - now), 0);
+	}
+}
+
+
 void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 {
 	if (!sender)
@@ -317,23 +849,31 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 #endif
 
 	PacketHeader* in_packet = check_packet(buffer, size);
-	if (in_packet)
-		in_packet->size -= sizeof(uint16_t) + sizeof(PacketHeader);
+	const uint32_t payloadSize = in_packet ? in_packet->size - sizeof(uint16_t) - sizeof(PacketHeader) : 0;
 
 	void* payload = in_packet + 1;
 
 	if (in_packet && PACKET_TYPE(in_packet->type) == TYPE_ERROR)
 	{
 		fprintf(stderr, "%s: error %s, state %s\n", __func__, error_to_str(in_packet->error), state_to_str(sender->state));
-		uv_timer_start(sender->timer, sender_onTimer, 1000, 0);
+		// Device is busy: give it the time an answer normally takes
+		uv_timer_start(sender->timer, sender_onTimer, us_to_ms(answer_timeout(sender, 0)), 0);
 		return;
 	}
 
+	// Stray answer to an earlier request (a duplicate, or one of the
+	// previous state) is dropped, the request's timer keeps running
+	const uint8_t windowed = sender->state == STATE_SEND_SAMPLES && sender->window.slots;
+	if (in_packet && !windowed && PACKET_TYPE(in_packet->type) != request_answer_type(sender))
+		return;
+
 	if (sender->state == STATE_GET_MODEL_INFO)
 	{
 		if (in_packet && PACKET_TYPE(in_packet->type) == TYPE_MODEL_INFO)
 		{
-			if (in_packet->size >= sizeof(ModelInfo))
+			answer_received(sender);
+
+			if (payloadSize >= sizeof(ModelInfo))
 			{
 				ModelInfo* mi = (ModelInfo*) payload;
 
@@ -361,18 +901,49 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 			return;
 		}
 
-		uv_buf_t buf = alloc_buffer(sender);
-
 		fprintf(stderr, ">> Request model info\n");
 
-		make_packet(sender, &buf, 0, TYPE_MODEL_INFO, ERROR_SUCCESS);
-		send_packet(sender, buf);
+		uv_buf_t buf = build_packet(sender, TYPE_MODEL_INFO, ERROR_SUCCESS, NULL, 0);
+		if (buf.base)
+			send_packet(sender, buf);
 	}
 	else if (sender->state == STATE_SEND_DATASET_INFO)
 	{
 		if (in_packet && PACKET_TYPE(in_packet->type) == TYPE_DATASET_INFO)
 		{
+			answer_received(sender);
+
 			fprintf(stderr, "Dataset info: columns in sample: %u\n", sender->columnsInSample);
+
+			// No options in the answer - device doesn't support pipelining
+			uint32_t window = 1;
+			uint32_t batch = 1;
+			if (wants_options(sender) && payloadSize >= sizeof(DatasetOptions))
+			{
+				const DatasetOptions* options = (const DatasetOptions*) payload;
+
+				window = options->window < sender->windowRequested ? options->window : sender->windowRequested;
+				if (!window)
+					window = 1;
+
+				if ((options->flags & DATASET_FLAG_BATCH) && sender->batchRequested != 1)
+					batch = batch_size(sender, options->bufferSize);
+			}
+
+			if (window > 1 || batch > 1)
+			{
+				if (!window_init(sender, window, batch))
+				{
+					fprintf(stderr, "%s: failed to alloc send window\n", __func__);
+					sender_finish(sender);
+					return;
+				}
+
+				fprintf(stderr, "Dataset info: packets in flight: %u, samples per packet: %u\n", window, batch);
+			}
+			else if (sender->batchRequested != 1)
+				fprintf(stderr, "Dataset info: batches not supported, sending one sample per packet\n");
+
 			state_transition(sender, STATE_SEND_SAMPLES);
 			return;
 		}
@@ -384,82 +955,49 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 			return;
 		}
 
-		uv_buf_t buf = alloc_buffer(sender);
+		struct
+		{
+			DatasetInfo    info;
+			DatasetOptions options;
+		}
+		di;
 
-		DatasetInfo* di = (DatasetInfo*) (buf.base + sizeof(PacketHeader));
-		di->columnsCount = sender->columnsInSample;
-		di->reverseByteOrder = 0;
+		di.info.columnsCount = sender->columnsInSample;
+		di.info.reverseByteOrder = 0;
+		di.options.window = sender->windowRequested;
+		di.options.flags = sender->batchRequested != 1 ? DATASET_FLAG_BATCH : 0;
+		di.options.bufferSize = parser_buffer_size(&sender->parser);
 
-		fprintf(stderr, ">> Send dataset info: columns in sample: %u\n", di->columnsCount);
+		fprintf(stderr, ">> Send dataset info: columns in sample: %u\n", di.info.columnsCount);
 
-		make_packet(sender, &buf, sizeof(DatasetInfo), TYPE_DATASET_INFO, ERROR_SUCCESS);
-		send_packet(sender, buf);
+		// Options are only sent when there is something to negotiate
+		const uint32_t diSize = wants_options(sender) ? sizeof(di) : sizeof(di.info);
+
+		uv_buf_t buf = build_packet(sender, TYPE_DATASET_INFO, ERROR_SUCCESS, &di, diSize);
+		if (buf.base)
+			send_packet(sender, buf);
+	}
+	else if (sender->state == STATE_SEND_SAMPLES && sender->window.slots)
+	{
+		if (!in_packet)
+		{
+			window_on_timer(sender);
+			if (!sender->error)
+				window_pump(sender);
+		}
+		else if (PACKET_TYPE(in_packet->type) == (sender->window.batch > 1 ? TYPE_DATASET_BATCH : TYPE_DATASET_SAMPLE))
+			window_on_answer(sender, in_packet, payload, payloadSize);
 	}
 	else if (sender->state == STATE_SEND_SAMPLES)
 	{
 		if (in_packet && PACKET_TYPE(in_packet->type) == TYPE_DATASET_SAMPLE)
 		{
-			if (in_packet->size >= (sizeof(float) * sender->columnsInResult))
-			{
-				static uint8_t hasHeader = 0;
-				
-				if (sender->sampleSent)
-				{
-					float* result = (float*) payload;
-
-					if (!hasHeader)
-					{
-						hasHeader = 1;
-						
-						if (sender->taskType == 2)
-						{
-							if (sender->columnsInResult == 1)
-							{
-								printf("target\n");
-							}
-							else
-							{
-								for (uint16_t i = 0; i < sender->columnsInResult; ++i)
-								{
-									printf("Predicted value for output #%u%s",
-											i + 1, (i + 1) < sender->columnsInResult ? "," : "");
-								}
-								printf("\n");
-							}
-						}
-						else
-						{
-							printf("target%s", sender->columnsInResult > 1 ? "," : "");
-							for (uint16_t i = 0; i < sender->columnsInResult; ++i)
-							{
-								printf("Probability of %d%s",
-										i, (i + 1) < sender->columnsInResult ? "," : "");
-							}
-							printf("\n");
-						}
-					}
-
-					if (sender->taskType < 2)
-					{
-						uint32_t index = 0;
-						float max = 0;
-						for (uint32_t i = 0; i < sender->columnsInResult; i++)
-						{
-							if (max < result[i])
-							{
-								index = i;
-								max = result[i];
-							}
-						}
-							
-						printf("%u,", index);
-					}
-
-					for (uint32_t i = 0; i < sender->columnsInResult; i++)
-						printf("%.6f%s", result[i], (i+1) < sender->columnsInResult ? "," : "");
-					printf("\n");
-				}
-			}
+			if (sender->sampleSent)
+				answer_received(sender);
+
+			if (sender->sampleSent)
+				deliver_results(sender, sender->row,
+								payloadSize >= (sizeof(float) * sender->columnsInResult) ? (const float*) payload : NULL, 1);
 			
 			sender->retries = 0;
 			if (sender->sampleSent)
@@ -467,10 +1005,9 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 				// static size_t nSamples = 1;
 				// fprintf(stderr, ">> Send dataset sample: #%zu\n", nSamples++);
 
-				if (0 == sender_read_sample(sender))
+				if (0 == sender_read_sample(sender, sender->sample))
 				{
-					fprintf(stderr, "================\n");
-					state_transition(sender, STATE_GET_PERFORMANCE_COUNTERS);
+					samples_done(sender);
 					return;
 				}
 			}
@@ -485,8 +1022,15 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 
 		if (!sender->sampleSent)
 		{
-			if (0 == sender_read_sample(sender))
+			if (0 == sender_read_sample(sender, sender->sample))
 			{
+				// Other devices may have taken all the shared rows
+				if (sender->shard && !sender->shard->failed)
+				{
+					samples_done(sender);
+					return;
+				}
+
 				fprintf(stderr, "%s: failed to read sample\n", __func__);
 				sender_finish(sender);
 				return;
@@ -495,19 +1039,29 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 			sender->sampleSent = 1;
 		}
 
-		uv_buf_t buf = alloc_buffer(sender);
+		uv_buf_t buf;
 
-		float* data = (float*) (buf.base + sizeof(PacketHeader));
-		memcpy(data, sender->sample, sender->sampleSize);
+		if (sender->packetCache)
+		{
+			buf.base = (char*) packet_cache_packet(sender->packetCache, sender->row);
+			buf.len = sender->packetCache->header.packetSize;
+		}
+		else
+		{
+			buf = build_packet(sender, TYPE_DATASET_SAMPLE, ERROR_SUCCESS, sender->sample, sender->sampleSize);
+			if (!buf.base)
+				return;
+		}
 
-		make_packet(sender, &buf, sender->sampleSize, TYPE_DATASET_SAMPLE, ERROR_SUCCESS);
 		send_packet(sender, buf);
 	}
 	else if (sender->state == STATE_GET_PERFORMANCE_COUNTERS)
 	{
 		if (in_packet && PACKET_TYPE(in_packet->type) == TYPE_PERF_REPORT)
 		{
-			if (in_packet->size >= sizeof(PerformanceReport))
+			answer_received(sender);
+
+			if (payloadSize >= sizeof(PerformanceReport))
 			{
 				PerformanceReport* pi = (PerformanceReport*) payload;
 
@@ -527,6 +1081,8 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 					   pi->freq, pi->flashUsage, pi->ramUsage, pi->ramUsageCur, pi->bufferSize,
 					   pi->usSampleAvg, pi->usSampleMin, pi->usSampleMax);
 
+				print_round_trip(sender);
+
 				state_transition(sender, STATE_SHUTDOWN);
 				return;
 			}
@@ -539,12 +1095,11 @@ void sender_fsm(Sender* sender,uv_timer_t* timer, void* buffer, size_t size)
 			return;
 		}
 
-		uv_buf_t buf = alloc_buffer(sender);
-
 		fprintf(stderr, ">> Request performance report\n");
 
-		make_packet(sender, &buf, 0, TYPE_PERF_REPORT, ERROR_SUCCESS);
-		send_packet(sender, buf);
+		uv_buf_t buf = build_packet(sender, TYPE_PERF_REPORT, ERROR_SUCCESS, NULL, 0);
+		if (buf.base)
+			send_packet(sender, buf);
 	}
 	else if (sender->state == STATE_SHUTDOWN)
 	{
@@ -6,5 +6,9 @@
 void state_transition(Sender* sender, SenderState state);
 void state_transition_delayed(Sender* sender, SenderState state, uint32_t delay);
 void sender_fsm(Sender* sender, uv_timer_t* timer, void* buffer, size_t size);
+// Releases packets whose sending completed
+void sender_release_buffers(Sender* sender, uv_buf_t* bufs, uint32_t count);
+// Prints result row in the format of the sender's model, header first
+void sender_print_result(Sender* sender, const float* result);
 
 #endif // SENDER_FSM_H
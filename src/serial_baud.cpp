@@ -0,0 +1,87 @@
+#include "serial_baud.h"
+
+#if defined(__linux__)
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+
+int serial_set_baud(int fd, uint32_t baud, uint32_t* actual)
+{
+	struct termios2 tio;
+
+	if (ioctl(fd, TCGETS2, &tio) != 0)
+		return -1;
+
+	tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+	tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+	tio.c_ispeed = baud;
+	tio.c_ospeed = baud;
+
+	if (ioctl(fd, TCSETS2, &tio) != 0 || ioctl(fd, TCGETS2, &tio) != 0)
+		return -1;
+
+	*actual = tio.c_ospeed;
+
+	return 0;
+}
+
+#else
+
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#if defined(__APPLE__)
+#include <IOKit/serial/ioss.h>
+#endif
+
+
+typedef struct
+{
+	uint32_t baud;
+	speed_t  speed;
+}
+StandardRate;
+
+
+static const StandardRate standard_rates[] =
+{
+	{ 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 },
+	{ 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 },
+};
+
+
+int serial_set_baud(int fd, uint32_t baud, uint32_t* actual)
+{
+	for (uint32_t i = 0; i < sizeof(standard_rates) / sizeof(standard_rates[0]); i++)
+	{
+		if (standard_rates[i].baud != baud)
+			continue;
+
+		struct termios tty;
+		if (tcgetattr(fd, &tty) != 0)
+			return -1;
+
+		cfsetospeed(&tty, standard_rates[i].speed);
+		cfsetispeed(&tty, standard_rates[i].speed);
+
+		if (tcsetattr(fd, TCSANOW, &tty) != 0)
+			return -1;
+
+		*actual = baud;
+		return 0;
+	}
+
+#if defined(__APPLE__)
+	speed_t speed = baud;
+	if (ioctl(fd, IOSSIOSPEED, &speed) != 0)
+		return -1;
+
+	*actual = baud;
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SERIAL_BAUD_H
+#define SERIAL_BAUD_H
+
+#include <stdint.h>
+
+
+// Sets any integer baud rate on a configured serial port (termios2 and
+// BOTHER on Linux, IOSSIOSPEED on macOS, standard rates elsewhere).
+// `actual` gets the rate reported back by the driver, which rounds to
+// what the UART clock can produce. Returns 0 on success.
+// Kept in its own translation unit: Linux termios2 headers clash with
+// <termios.h>.
+int serial_set_baud(int fd, uint32_t baud, uint32_t* actual);
+
+
+#endif // SERIAL_BAUD_H
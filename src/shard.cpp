@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <stdexcept>
+
+#include "shard.h"
+#include "sender_fsm.h"
+#include "protocol.h"
+
+
+#define SHARD_MIN_CAPACITY      (256)
+
+
+Shard* shard_create(const SenderConfig* config)
+{
+	Shard* shard = (Shard*) calloc(1, sizeof(Shard));
+	if (!shard)
+		return NULL;
+
+	try
+	{
+		shard->dataset = dataset_open(config->dataset, config->parseThreads);
+	}
+	catch (std::exception& e)
+	{
+		fprintf(stderr, "Failed to open dataset: %s\n", e.what());
+		shard_destroy(shard);
+		return NULL;
+	}
+
+	if (!shard->dataset->Columns())
+	{
+		fprintf(stderr, "Nothing to send: empty file\n");
+		shard_destroy(shard);
+		return NULL;
+	}
+
+	shard->columnsInSample = shard->dataset->Columns() + 1;
+	shard->trace = trace_log_loop(config->trace);
+	shard->nextRow = shard->printedRow = config->startRow;
+	shard->endRow = config->endRow;
+
+	if (config->packetCache)
+	{
+		shard->packetCache = packet_cache_open(config->packetCache, shard->dataset, shard->columnsInSample);
+		if (!shard->packetCache)
+		{
+			fprintf(stderr, "Failed to open packet cache\n");
+			shard_destroy(shard);
+			return NULL;
+		}
+
+		if (config->startRow > shard->packetCache->header.packetsCount)
+		{
+			fprintf(stderr, "Start row is out of range (%llu rows)\n",
+					(unsigned long long) shard->packetCache->header.packetsCount);
+			shard_destroy(shard);
+			return NULL;
+		}
+
+		if (config->progress)
+			shard->rows = sender_rows_total(config, NULL, shard->packetCache);
+
+		return shard;
+	}
+
+	if (config->progress)
+		shard->rows = sender_rows_total(config, shard->dataset, NULL);
+
+	if (config->startRow)
+	{
+		try
+		{
+			shard->dataset->Seek(config->startRow);
+		}
+		catch (std::exception& e)
+		{
+			fprintf(stderr, "Failed to seek dataset: %s\n", e.what());
+			shard_destroy(shard);
+			return NULL;
+		}
+	}
+
+	if (config->readAhead)
+	{
+		shard->readAhead = new ReadAhead(shard->dataset, config->readAhead);
+		shard->readAhead->SetTrace(trace_log_ring(config->trace, "read-ahead"), 0);
+		if (!shard->readAhead->Start())
+		{
+			fprintf(stderr, "Failed to start read-ahead thread\n");
+			shard_destroy(shard);
+			return NULL;
+		}
+	}
+
+	return shard;
+}
+
+
+void shard_destroy(Shard* shard)
+{
+	if (!shard)
+		return;
+
+	if (shard->readAhead)
+		delete shard->readAhead;
+
+	if (shard->packetCache)
+		packet_cache_close(shard->packetCache);
+
+	if (shard->dataset)
+		delete shard->dataset;
+
+	free(shard->results);
+	free(shard->answered);
+	free(shard->hasResult);
+	free(shard);
+}
+
+
+uint8_t shard_read(Shard* shard, float* sample, uint64_t* row)
+{
+	if (shard->failed || shard->exhausted)
+		return 0;
+
+	if (shard->endRow && shard->nextRow >= shard->endRow)
+	{
+		shard->exhausted = 1;
+		return 0;
+	}
+
+	if (shard->packetCache)
+	{
+		if (shard->nextRow >= shard->packetCache->header.packetsCount)
+		{
+			shard->exhausted = 1;
+			return 0;
+		}
+
+		memcpy(sample, packet_cache_packet(shard->packetCache, shard->nextRow) + sizeof(PacketHeader),
+			   shard->columnsInSample * sizeof(float));
+	}
+	else
+	{
+		int res;
+		if (shard->readAhead)
+			res = shard->readAhead->Pop(sample);
+		else
+		{
+			const uint64_t traceAt = trace_now(shard->trace);
+			res = shard->dataset->ReadRow(sample);
+			trace_span(shard->trace, TRACE_PARSE, NULL, 0, traceAt, 1);
+		}
+
+		if (res <= 0)
+		{
+			if (res < 0)
+			{
+				fprintf(stderr, "%s: failed to read sample\n", __func__);
+				shard->failed = 1;
+			}
+
+			shard->exhausted = 1;
+			return 0;
+		}
+
+		sample[shard->columnsInSample - 1] = 1.0;
+	}
+
+	*row = shard->nextRow++;
+
+	return 1;
+}
+
+
+//
+// Makes room for results of `count` rows from printedRow on. Waiting
+// results keep their rows, only the slots change.
+//
+static uint8_t shard_grow(Shard* shard, uint64_t count)
+{
+	uint64_t capacity = shard->capacity ? shard->capacity : SHARD_MIN_CAPACITY;
+	while (capacity < count)
+		capacity *= 2;
+
+	if (capacity > UINT32_MAX)
+		return 0;
+
+	float* results = (float*) malloc(capacity * shard->resultColumns * sizeof(float));
+	Sender** answered = (Sender**) calloc(capacity, sizeof(Sender*));
+	uint8_t* hasResult = (uint8_t*) calloc(capacity, sizeof(uint8_t));
+
+	if (!results || !answered || !hasResult)
+	{
+		free(results);
+		free(answered);
+		free(hasResult);
+		return 0;
+	}
+
+	const uint32_t columns = shard->resultColumns;
+
+	for (uint64_t row = shard->printedRow; row < shard->printedRow + shard->capacity; row++)
+	{
+		const uint32_t from = row & (shard->capacity - 1);
+		const uint32_t to = row & (capacity - 1);
+
+		if (!shard->answered[from])
+			continue;
+
+		answered[to] = shard->answered[from];
+		hasResult[to] = shard->hasResult[from];
+		memcpy(results + (size_t) to * columns, shard->results + (size_t) from * columns, columns * sizeof(float));
+	}
+
+	free(shard->results);
+	free(shard->answered);
+	free(shard->hasResult);
+
+	shard->results = results;
+	shard->answered = answered;
+	shard->hasResult = hasResult;
+	shard->capacity = capacity;
+
+	return 1;
+}
+
+
+void shard_result(Shard* shard, Sender* sender, uint64_t row, const float* result)
+{
+	// Late answer to a row printed already
+	if (shard->failed || row < shard->printedRow || row >= shard->nextRow)
+		return;
+
+	if (!shard->resultColumns)
+		shard->resultColumns = sender->columnsInResult;
+
+	if (sender->columnsInResult != shard->resultColumns)
+	{
+		fprintf(stderr, "%s: devices answer with different result columns (%u and %u)\n", __func__,
+				shard->resultColumns, sender->columnsInResult);
+		shard->failed = 1;
+		return;
+	}
+
+	if (row - shard->printedRow >= shard->capacity && !shard_grow(shard, row - shard->printedRow + 1))
+	{
+		fprintf(stderr, "%s: failed to alloc results\n", __func__);
+		shard->failed = 1;
+		return;
+	}
+
+	const uint32_t columns = shard->resultColumns;
+	uint32_t index = row & (shard->capacity - 1);
+
+	if (shard->answered[index])
+		return;
+
+	shard->answered[index] = sender;
+	shard->hasResult[index] = result != NULL;
+	if (result)
+		memcpy(shard->results + (size_t) index * columns, result, columns * sizeof(float));
+
+	for (index = shard->printedRow & (shard->capacity - 1); shard->answered[index];
+		 index = shard->printedRow & (shard->capacity - 1))
+	{
+		if (shard->hasResult[index])
+			sender_print_result(shard->answered[index], shard->results + (size_t) index * columns);
+
+		shard->answered[index] = NULL;
+		shard->printedRow++;
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+
+#include "sender.h"
+
+
+//
+// Dataset rows shared by several senders on one loop. Rows are handed
+// out one packet at a time to whichever sender has room in its window,
+// so faster devices take more of them. Results come back in any order
+// and wait here until all the earlier rows are answered, then they are
+// printed in dataset order.
+//
+struct Shard
+{
+	DatasetReader* dataset;
+	ReadAhead*     readAhead;
+	PacketCache*   packetCache;
+	uint32_t       columnsInSample;     // With bias
+	uint64_t       nextRow;             // Next row to hand out
+	uint64_t       endRow;              // 0 - end of dataset
+	uint64_t       rows;                // Rows selected, 0 - unknown (only counted for progress)
+	uint8_t        exhausted;
+	uint8_t        failed;              // A device or the dataset failed, rows stop
+	Trace*         trace;               // Rows parsed on the loop, NULL - off
+
+	// Results of rows [printedRow, nextRow), slot of a row is row % capacity
+	float*         results;
+	Sender**       answered;            // Sender whose answer is in the slot
+	uint8_t*       hasResult;
+	uint32_t       capacity;
+	uint32_t       resultColumns;
+	uint64_t       printedRow;          // Next row to print
+	uint32_t       headerPrinted;
+};
+
+
+// Opens the dataset rows selected by `config` for sharing.
+// Returns NULL on failure.
+Shard* shard_create(const SenderConfig* config);
+void shard_destroy(Shard* shard);
+
+// Reads the next row into sample[0..columnsInSample), returns 0 when
+// there are no more rows
+uint8_t shard_read(Shard* shard, float* sample, uint64_t* row);
+
+// Accounts the answer to `row` from `sender`, `result` NULL - the device
+// answered without a result. Prints all the results ready in order.
+void shard_result(Shard* shard, Sender* sender, uint64_t row, const float* result);
+
+// All rows handed out were answered and printed
+static inline uint8_t shard_complete(const Shard* shard)
+{
+	return !shard->failed && shard->printedRow == shard->nextRow;
+}
+
+
+#endif // SHARD_H
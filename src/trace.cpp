@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+
+static const struct
+{
+	const char* name;
+	const char* value;          // Meaning of TraceEvent::value, NULL - none
+	uint8_t     async;          // Spans of the kind overlap on the thread
+}
+kinds[TRACE_KINDS] =
+{
+	{ "parse", "rows",    0 },
+	{ "build", "bytes",   0 },
+	{ "write", "bytes",   0 },
+	{ "wait",  "samples", 1 },
+	{ "state", NULL,      1 },
+	{ "timer", NULL,      0 },
+};
+
+
+TraceLog* trace_log_create()
+{
+	TraceLog* log = (TraceLog*) calloc(1, sizeof(TraceLog));
+	if (!log)
+		return NULL;
+
+	if (!trace_log_ring(log, "uv loop"))
+	{
+		trace_log_destroy(log);
+		return NULL;
+	}
+
+	return log;
+}
+
+
+void trace_log_destroy(TraceLog* log)
+{
+	if (!log)
+		return;
+
+	for (uint32_t i = 0; i < log->count; i++)
+	{
+		free(log->rings[i]->events);
+		free(log->rings[i]);
+	}
+
+	free(log->rings);
+	free(log);
+}
+
+
+Trace* trace_log_ring(TraceLog* log, const char* name)
+{
+	if (!log)
+		return NULL;
+
+	Trace** rings = (Trace**) realloc(log->rings, (log->count + 1) * sizeof(Trace*));
+	if (!rings)
+		return NULL;
+
+	log->rings = rings;
+
+	// Pages are only touched as the ring fills
+	Trace* trace = (Trace*) calloc(1, sizeof(Trace));
+	if (!trace || !(trace->events = (TraceEvent*) malloc(TRACE_RING_EVENTS * sizeof(TraceEvent))))
+	{
+		free(trace);
+		return NULL;
+	}
+
+	trace->tid = log->count + 1;
+	snprintf(trace->name, sizeof(trace->name), "%s", name);
+
+	log->rings[log->count++] = trace;
+
+	return trace;
+}
+
+
+static void write_event(FILE* f, const Trace* trace, const TraceEvent* e, uint64_t id, uint64_t base)
+{
+	const char* kind = kinds[e->kind].name;
+	const char* name = e->name ? e->name : kind;
+	const double ts = (e->begin - base) / 1000.0;
+
+	char args[64];
+	if (kinds[e->kind].value)
+		snprintf(args, sizeof(args), "{\"device\":%u,\"%s\":%u}", e->device, kinds[e->kind].value, e->value);
+	else
+		snprintf(args, sizeof(args), "{\"device\":%u}", e->device);
+
+	if (!kinds[e->kind].async)
+	{
+		fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":%s}",
+				name, kind, trace->tid, ts, (e->end - e->begin) / 1000.0, args);
+		return;
+	}
+
+	// Overlapping spans are async slices, paired by id
+	fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"b\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":%s}",
+			name, kind, (unsigned long long) id, trace->tid, ts, args);
+	fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"e\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+			name, kind, (unsigned long long) id, trace->tid, (e->end - base) / 1000.0);
+}
+
+
+int trace_log_write(const TraceLog* log, const char* fileName)
+{
+	FILE* f = fopen(fileName, "w");
+	if (!f)
+	{
+		fprintf(stderr, "Trace: failed to create %s\n", fileName);
+		return 1;
+	}
+
+	// Timestamps count from the earliest span kept
+	uint64_t base = UINT64_MAX;
+	uint64_t total = 0;
+
+	for (uint32_t i = 0; i < log->count; i++)
+	{
+		const Trace* trace = log->rings[i];
+		const uint64_t first = trace->count > TRACE_RING_EVENTS ? trace->count - TRACE_RING_EVENTS : 0;
+
+		for (uint64_t n = first; n < trace->count; n++)
+		{
+			const TraceEvent* e = &trace->events[n & (TRACE_RING_EVENTS - 1)];
+			if (base > e->begin)
+				base = e->begin;
+		}
+
+		total += trace->count - first;
+	}
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+			"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"uploader\"}}");
+
+	uint64_t id = 0;
+
+	for (uint32_t i = 0; i < log->count; i++)
+	{
+		const Trace* trace = log->rings[i];
+		const uint64_t first = trace->count > TRACE_RING_EVENTS ? trace->count - TRACE_RING_EVENTS : 0;
+
+		fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				trace->tid, trace->name);
+
+		for (uint64_t n = first; n < trace->count; n++)
+			write_event(f, trace, &trace->events[n & (TRACE_RING_EVENTS - 1)], id++, base);
+	}
+
+	fprintf(f, "\n]}\n");
+
+	const int failed = ferror(f);
+	if (0 != fclose(f) || failed)
+	{
+		fprintf(stderr, "Trace: failed to write %s\n", fileName);
+		return 1;
+	}
+
+	fprintf(stderr, "Trace: %llu spans written to %s\n", (unsigned long long) total, fileName);
+
+	return 0;
+}
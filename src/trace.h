@@ -0,0 +1,110 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <uv.h>
+
+
+//
+// Timeline of an upload for chrome://tracing and Perfetto. Spans go
+// into preallocated rings, one per writing thread, so recording is a
+// clock read and a store; when a ring is full the oldest spans are
+// overwritten. Everything is written out as Chrome trace event JSON
+// once the threads are done.
+//
+#define TRACE_RING_EVENTS       (1u << 20)      // Power of 2
+
+
+typedef enum
+{
+	TRACE_PARSE = 0,        // Dataset row parsed, value - rows
+	TRACE_BUILD,            // Packet built, value - bytes
+	TRACE_WRITE,            // Write syscall, value - bytes
+	TRACE_WAIT,             // Request sent until its answer, value - samples
+	TRACE_STATE,            // State transition until its timer fires
+	TRACE_TIMER,            // Timer callback
+	TRACE_KINDS
+}
+TraceKind;
+
+
+typedef struct
+{
+	uint64_t    begin;          // ns, uv_hrtime()
+	uint64_t    end;
+	const char* name;           // Static string, NULL - name of the kind
+	uint32_t    value;
+	uint16_t    device;         // Index in the devices list
+	uint8_t     kind;
+}
+TraceEvent;
+
+
+// Spans of one thread
+typedef struct
+{
+	TraceEvent* events;
+	uint64_t    count;          // Recorded, the last TRACE_RING_EVENTS are kept
+	uint32_t    tid;
+	char        name[32];
+}
+Trace;
+
+
+typedef struct
+{
+	Trace**  rings;
+	uint32_t count;
+}
+TraceLog;
+
+
+// Creates the log with the uv loop's ring. Returns NULL on failure.
+TraceLog* trace_log_create();
+void trace_log_destroy(TraceLog* log);
+
+// Ring of the uv loop thread
+static inline Trace* trace_log_loop(TraceLog* log)
+{
+	return log ? log->rings[0] : NULL;
+}
+
+// Ring for another thread, created before the thread starts.
+// Returns NULL on failure or when `log` is NULL.
+Trace* trace_log_ring(TraceLog* log, const char* name);
+
+// Writes all rings as Chrome trace event JSON, returns 0 on success
+int trace_log_write(const TraceLog* log, const char* fileName);
+
+
+// Start of a span, 0 when tracing is off
+static inline uint64_t trace_now(const Trace* trace)
+{
+	return trace ? uv_hrtime() : 0;
+}
+
+
+static inline void trace_record(Trace* trace, TraceKind kind, const char* name, uint32_t device,
+								uint64_t begin, uint64_t end, uint32_t value)
+{
+	TraceEvent* e = &trace->events[trace->count++ & (TRACE_RING_EVENTS - 1)];
+
+	e->begin = begin;
+	e->end = end;
+	e->name = name;
+	e->value = value;
+	e->device = device;
+	e->kind = kind;
+}
+
+
+// Records span from `begin` to now
+static inline void trace_span(Trace* trace, TraceKind kind, const char* name, uint32_t device,
+							  uint64_t begin, uint32_t value)
+{
+	if (trace)
+		trace_record(trace, kind, name, device, begin, uv_hrtime(), value);
+}
+
+
+#endif // TRACE_H
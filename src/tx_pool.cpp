@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "tx_pool.h"
+
+
+static inline uint8_t owns_buffer(const TxPool* pool, const void* ptr)
+{
+	return pool->buffers && (const uint8_t*) ptr >= pool->buffers &&
+		   (const uint8_t*) ptr < pool->buffers + (size_t) pool->count * pool->bufferStride;
+}
+
+
+static inline uint8_t owns_request(const TxPool* pool, const void* ptr)
+{
+	return pool->requests && (const TxRequest*) ptr >= pool->requests &&
+		   (const TxRequest*) ptr < pool->requests + pool->count;
+}
+
+
+uint8_t tx_pool_init(TxPool* pool, uint32_t count, uint32_t bufferSize)
+{
+	memset(pool, 0, sizeof(TxPool));
+
+	pool->bufferSize = bufferSize;
+	pool->bufferStride = (bufferSize + 15) & ~15u;
+	pool->count = count;
+
+	pool->heapAllocations += 2;
+	pool->buffers = (uint8_t*) malloc((size_t) count * pool->bufferStride);
+	pool->requests = (TxRequest*) calloc(count, sizeof(TxRequest));
+
+	if (!pool->buffers || !pool->requests)
+	{
+		tx_pool_free(pool);
+		return 1;
+	}
+
+	for (uint32_t i = count; i-- > 0;)
+	{
+		void* buffer = pool->buffers + (size_t) i * pool->bufferStride;
+		memcpy(buffer, &pool->freeBuffers, sizeof(void*));
+		pool->freeBuffers = buffer;
+
+		pool->requests[i].next = pool->freeRequests;
+		pool->freeRequests = &pool->requests[i];
+	}
+
+	return 0;
+}
+
+
+void tx_pool_free(TxPool* pool)
+{
+	free(pool->buffers);
+	free(pool->requests);
+
+	pool->buffers = NULL;
+	pool->requests = NULL;
+	pool->freeBuffers = NULL;
+	pool->freeRequests = NULL;
+	pool->count = 0;
+}
+
+
+uint8_t* tx_pool_buffer(TxPool* pool, uint32_t size)
+{
+	if (pool->freeBuffers && size <= pool->bufferSize)
+	{
+		uint8_t* buffer = (uint8_t*) pool->freeBuffers;
+		memcpy(&pool->freeBuffers, buffer, sizeof(void*));
+		return buffer;
+	}
+
+	pool->heapAllocations++;
+	return (uint8_t*) malloc(size);
+}
+
+
+void tx_pool_release_buffer(TxPool* pool, void* buffer)
+{
+	if (!owns_buffer(pool, buffer))
+	{
+		free(buffer);
+		return;
+	}
+
+	memcpy(buffer, &pool->freeBuffers, sizeof(void*));
+	pool->freeBuffers = buffer;
+}
+
+
+uv_udp_send_t* tx_pool_request(TxPool* pool)
+{
+	if (pool->freeRequests)
+	{
+		TxRequest* req = pool->freeRequests;
+		pool->freeRequests = req->next;
+
+		// Callers expect a clean request, as from calloc
+		memset(&req->req, 0, sizeof(req->req));
+		return &req->req;
+	}
+
+	pool->heapAllocations++;
+	return (uv_udp_send_t*) calloc(1, sizeof(TxRequest));
+}
+
+
+void tx_pool_release_request(TxPool* pool, uv_udp_send_t* req)
+{
+	if (!owns_request(pool, req))
+	{
+		free(req);
+		return;
+	}
+
+	TxRequest* entry = (TxRequest*) req;
+	entry->next = pool->freeRequests;
+	pool->freeRequests = entry;
+}
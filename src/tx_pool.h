@@ -0,0 +1,46 @@
+#ifndef TX_POOL_H
+#define TX_POOL_H
+
+#include <stdint.h>
+#include <uv.h>
+
+
+//
+// Packet buffers and UDP send requests for the packets in flight,
+// allocated once and recycled through free lists. When the pool runs
+// dry (more retransmits in flight than expected, oversized packet)
+// the heap is used and counted in `heapAllocations`.
+//
+typedef struct TxRequest
+{
+	uv_udp_send_t     req;          // Must be first
+	struct TxRequest* next;
+}
+TxRequest;
+
+
+typedef struct
+{
+	uint8_t*   buffers;
+	uint32_t   bufferSize;
+	uint32_t   bufferStride;
+	uint32_t   count;
+	void*      freeBuffers;         // Free buffers, each links the next one
+	TxRequest* requests;
+	TxRequest* freeRequests;
+	uint64_t   heapAllocations;     // Including the pool itself
+}
+TxPool;
+
+
+uint8_t tx_pool_init(TxPool* pool, uint32_t count, uint32_t bufferSize);
+void tx_pool_free(TxPool* pool);
+
+uint8_t* tx_pool_buffer(TxPool* pool, uint32_t size);
+void tx_pool_release_buffer(TxPool* pool, void* buffer);
+
+uv_udp_send_t* tx_pool_request(TxPool* pool);
+void tx_pool_release_request(TxPool* pool, uv_udp_send_t* req);
+
+
+#endif // TX_POOL_H
@@ -0,0 +1,95 @@
+//
+// CRC16 kernels against the bytewise table CRC: every length from 0 to
+// 2 KB, every alignment within 16 bytes, several initial values.
+// crc16_copy() is checked to copy the input exactly as well.
+//
+#include <stdio.h>
+#include <stdlib.h>
+
+// Kernels are internal to the translation unit
+#include "../src/checksum.cpp"
+
+
+#define MAX_LENGTH      2048
+#define ALIGNMENTS      16
+
+
+static uint16_t crc16_bytewise(const uint8_t* p, uint32_t wLen, uint16_t wCRC)
+{
+	for (; wLen; wLen--, p++)
+		wCRC = (wCRC << 8) ^ crc_ccitt_tab[(wCRC >> 8) ^ *p];
+
+	return wCRC;
+}
+
+
+static uint32_t failures = 0;
+
+
+static void check(const char* name, uint32_t length, uint32_t alignment, uint16_t init,
+				  uint16_t expected, uint16_t actual)
+{
+	if (expected == actual)
+		return;
+
+	if (failures++ < 16)
+		fprintf(stderr, "%s: length %u, alignment %u, init 0x%04x: 0x%04x, expected 0x%04x\n",
+				name, length, alignment, init, actual, expected);
+}
+
+
+int main()
+{
+	static const uint16_t inits[] = { 0x0000, 0xffff, 0x1d0f, 0x8005, 0x5aa5 };
+
+	uint8_t* src = (uint8_t*) malloc(MAX_LENGTH + ALIGNMENTS);
+	uint8_t* dst = (uint8_t*) malloc(MAX_LENGTH + ALIGNMENTS + 1);
+	if (!src || !dst)
+		return 1;
+
+	srand(1);
+	for (uint32_t i = 0; i < MAX_LENGTH + ALIGNMENTS; i++)
+		src[i] = (uint8_t) rand();
+
+	crc16_fn fast = crc16_select();
+	const int clmul = fast != crc16_slice;
+	uint64_t cases = 0;
+
+	for (uint32_t alignment = 0; alignment < ALIGNMENTS; alignment++)
+		for (uint32_t length = 0; length <= MAX_LENGTH; length++)
+			for (uint32_t i = 0; i < sizeof(inits) / sizeof(inits[0]); i++)
+			{
+				const uint8_t* p = src + alignment;
+				const uint16_t init = inits[i];
+				const uint16_t expected = crc16_bytewise(p, length, init);
+
+				check("crc16_slice", length, alignment, init, expected, crc16_slice(p, length, init, NULL));
+				check("crc16_table", length, alignment, init, expected, crc16_table((uint8_t*) p, length, init));
+
+				// Folding needs CRC_VECTOR_MIN bytes
+				if (clmul && length >= CRC_VECTOR_MIN)
+					check("crc16_clmul", length, alignment, init, expected, fast(p, length, init, NULL));
+
+				// Destination misaligned differently from the source, guard byte after it
+				uint8_t* to = dst + (ALIGNMENTS - alignment) % ALIGNMENTS;
+				to[length] = 0xa5;
+
+				check("crc16_copy", length, alignment, init, expected, crc16_copy(to, p, length, init));
+
+				if (memcmp(to, p, length) != 0 || to[length] != 0xa5)
+				{
+					if (failures++ < 16)
+						fprintf(stderr, "crc16_copy: length %u, alignment %u: bad copy\n", length, alignment);
+				}
+
+				cases++;
+			}
+
+	free(src);
+	free(dst);
+
+	printf("checksum_test: %llu cases%s, %u failures\n", (unsigned long long) cases,
+		   clmul ? "" : " (no PCLMULQDQ, folding not tested)", failures);
+
+	return failures ? 1 : 0;
+}
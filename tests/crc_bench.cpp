@@ -0,0 +1,105 @@
+//
+// CRC16 throughput in bytes per cycle, bytewise table loop against the
+// slice-by-16 tables (and carry-less multiply folding where the CPU has
+// it), over the packet sizes the uploader sends.
+// Cycles are TSC ticks on x86, nanoseconds elsewhere.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Kernels are internal to the translation unit
+#include "../src/checksum.cpp"
+
+
+static inline uint64_t ticks()
+{
+#if defined(CRC16_X86)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+
+static uint16_t crc16_bytewise(const uint8_t* p, uint32_t wLen, uint16_t wCRC, uint8_t* dst)
+{
+	(void) dst;
+
+	for (; wLen; wLen--, p++)
+		wCRC = (wCRC << 8) ^ crc_ccitt_tab[(wCRC >> 8) ^ *p];
+
+	return wCRC;
+}
+
+
+// Best of several runs, bytes per tick
+static double measure(crc16_fn fn, const uint8_t* data, uint32_t size)
+{
+	const uint32_t iterations = (64u << 20) / size / 8 + 1;
+	double best = 0;
+	volatile uint16_t sink = 0;
+
+	for (uint32_t run = 0; run < 8; run++)
+	{
+		uint16_t crc = 0;
+		const uint64_t start = ticks();
+
+		for (uint32_t i = 0; i < iterations; i++)
+			crc = fn(data, size, crc, NULL);
+
+		const uint64_t elapsed = ticks() - start;
+		sink = sink ^ crc;
+
+		const double rate = (double) size * iterations / (elapsed ? elapsed : 1);
+		if (best < rate)
+			best = rate;
+	}
+
+	return best;
+}
+
+
+int main()
+{
+	static const uint32_t sizes[] = { 10, 16, 32, 64, 128, 256, 512, 1024, 2048 };
+
+	uint8_t* data = (uint8_t*) malloc(2048);
+	if (!data)
+		return 1;
+
+	for (uint32_t i = 0; i < 2048; i++)
+		data[i] = (uint8_t) rand();
+
+	crc16_fn fast = crc16_select();
+	const int clmul = fast != crc16_slice;
+
+	printf("%-6s %10s %10s %10s\n", "bytes", "bytewise", "slice16", clmul ? "clmul" : "-");
+
+	for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		const uint32_t size = sizes[i];
+
+		printf("%-6u %10.3f %10.3f", size, measure(crc16_bytewise, data, size), measure(crc16_slice, data, size));
+
+		// Folding needs CRC_VECTOR_MIN bytes
+		if (clmul && size >= CRC_VECTOR_MIN)
+			printf(" %10.3f", measure(fast, data, size));
+
+		printf("\n");
+	}
+
+	printf("(bytes per %s)\n",
+#if defined(CRC16_X86)
+		   "TSC cycle"
+#else
+		   "ns"
+#endif
+		  );
+
+	free(data);
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+//
+// CSV row splitting on a wide dataset (hundreds of columns): separator
+// search by each csv_scan() kernel the CPU has, against getline based
+// splitting as SimpleCsvReader did it, then the full MmapCsvReader parse.
+// The dataset is generated in memory, throughput is per byte of CSV.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Kernels are internal to the translation unit
+#include "../src/csv_scan.cpp"
+#include "../src/mmap_csv.h"
+
+
+#define COLUMNS         300
+#define ROWS            20000
+#define RUNS            5
+
+// Same chunking as MmapCsvReader
+#define INDEX_CAPACITY  (16 * 1024)
+#define SCAN_CHUNK      (1u << 20)
+
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static std::string make_dataset()
+{
+	std::string text;
+	char field[32];
+
+	for (uint32_t c = 0; c < COLUMNS; c++)
+	{
+		snprintf(field, sizeof(field), c ? ",f%u" : "f%u", c);
+		text += field;
+	}
+	text += '\n';
+
+	for (uint32_t r = 0; r < ROWS; r++)
+	{
+		for (uint32_t c = 0; c < COLUMNS; c++)
+		{
+			snprintf(field, sizeof(field), c ? ",%.6g" : "%.6g", (rand() - RAND_MAX / 2) / 1000.0);
+			text += field;
+		}
+		text += '\n';
+	}
+
+	return text;
+}
+
+
+// Best of several runs, seconds; `separators` - found by the last run
+static double scan(csv_scan_fn fn, const std::string& text, uint64_t* separators)
+{
+	std::vector<uint32_t> offsets(INDEX_CAPACITY);
+	double best = 1e9;
+
+	for (uint32_t r = 0; r < RUNS; r++)
+	{
+		const char* p = text.data();
+		const char* end = p + text.size();
+		uint64_t count = 0;
+
+		const double start = now();
+
+		while (p < end)
+		{
+			const size_t size = end - p > SCAN_CHUNK ? SCAN_CHUNK : end - p;
+			size_t scanned = 0;
+
+			count += fn(p, size, ',', &offsets[0], offsets.size(), &scanned);
+			p += scanned;
+		}
+
+		const double elapsed = now() - start;
+		best = elapsed < best ? elapsed : best;
+		*separators = count;
+	}
+
+	return best;
+}
+
+
+static double scan_getline(const std::string& text, uint64_t* separators)
+{
+	double best = 1e9;
+
+	for (uint32_t r = 0; r < RUNS; r++)
+	{
+		std::istringstream file(text);
+		std::string line;
+		std::string field;
+		uint64_t count = 0;
+
+		const double start = now();
+
+		while (getline(file, line))
+		{
+			std::istringstream sstr(line);
+			while (getline(sstr, field, ','))
+				count++;
+		}
+
+		const double elapsed = now() - start;
+		best = elapsed < best ? elapsed : best;
+		*separators = count;
+	}
+
+	return best;
+}
+
+
+static double parse(const std::string& text, uint64_t* fields)
+{
+	std::vector<float> values(COLUMNS);
+	double best = 1e9;
+	volatile float sink = 0;
+
+	for (uint32_t r = 0; r < RUNS; r++)
+	{
+		MmapCsvReader reader(text.data(), text.size());
+		uint64_t count = 0;
+		size_t n;
+
+		const double start = now();
+
+		while ((n = reader.ReadLine(&values[0], values.size())) != 0)
+		{
+			count += n;
+			sink = sink + values[0];
+		}
+
+		const double elapsed = now() - start;
+		best = elapsed < best ? elapsed : best;
+		*fields = count;
+	}
+
+	return best;
+}
+
+
+int main()
+{
+	srand(1);
+
+	const std::string text = make_dataset();
+	const double mb = text.size() / 1e6;
+
+	printf("%u columns, %u rows, %.1f MB\n", COLUMNS, ROWS + 1, mb);
+
+	uint64_t count;
+	double t = scan(csv_scan_scalar, text, &count);
+	printf("%-16s %8.0f MB/s, %10llu separators\n", "scan scalar", mb / t, (unsigned long long) count);
+
+#if defined(CSV_SCAN_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse2"))
+	{
+		t = scan(csv_scan_sse2, text, &count);
+		printf("%-16s %8.0f MB/s, %10llu separators\n", "scan sse2", mb / t, (unsigned long long) count);
+	}
+
+	if (__builtin_cpu_supports("avx2"))
+	{
+		t = scan(csv_scan_avx2, text, &count);
+		printf("%-16s %8.0f MB/s, %10llu separators\n", "scan avx2", mb / t, (unsigned long long) count);
+	}
+#endif
+
+	t = scan_getline(text, &count);
+	printf("%-16s %8.0f MB/s, %10llu fields\n", "getline split", mb / t, (unsigned long long) count);
+
+	t = parse(text, &count);
+	printf("%-16s %8.0f MB/s, %10llu fields, %.3f s\n", "full parse", mb / t, (unsigned long long) count, t);
+
+	return 0;
+}
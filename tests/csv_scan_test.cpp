@@ -0,0 +1,269 @@
+//
+// CSV separator scanner: the SSE2 and AVX2 kernels (where the CPU has
+// them) against the scalar one and a bytewise reference, for every
+// length up to several blocks, every alignment within a block, several
+// delimiters, sparse and dense separators and index capacities small
+// enough to stop the scan early.
+// MmapCsvReader is then run over generated files with custom delimiters,
+// CRLF line ends and without the final newline.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+// Kernels are internal to the translation unit
+#include "../src/csv_scan.cpp"
+#include "../src/mmap_csv.h"
+
+
+#define MAX_LENGTH      (8 * CSV_SCAN_BLOCK + 8)
+#define ALIGNMENTS      CSV_SCAN_BLOCK
+
+
+static uint32_t failures = 0;
+
+
+static void fail(const char* name, size_t length, size_t alignment, char delimiter, size_t capacity,
+				 const char* what)
+{
+	if (failures++ < 16)
+		fprintf(stderr, "%s: length %zu, alignment %zu, delimiter 0x%02x, capacity %zu: %s\n",
+				name, length, alignment, (unsigned char) delimiter, capacity, what);
+}
+
+
+static size_t scan_bytewise(const char* data, size_t size, char delimiter, uint32_t* offsets)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < size; i++)
+		if (data[i] == delimiter || data[i] == '\n')
+			offsets[count++] = (uint32_t) i;
+
+	return count;
+}
+
+
+//
+// Kernel output must be the reference offsets below `scanned`, and
+// everything when the index has room for it
+//
+static void check_kernel(const char* name, csv_scan_fn fn, const char* data, size_t length,
+						 size_t alignment, char delimiter, size_t capacity,
+						 const uint32_t* expected, size_t expectedCount, uint32_t* offsets)
+{
+	size_t scanned = (size_t) -1;
+	const size_t count = fn(data, length, delimiter, offsets, capacity, &scanned);
+
+	if (scanned > length || count > capacity)
+	{
+		fail(name, length, alignment, delimiter, capacity, "overrun");
+		return;
+	}
+
+	if (capacity >= length + CSV_SCAN_BLOCK && scanned != length)
+		fail(name, length, alignment, delimiter, capacity, "stopped early");
+
+	size_t below = 0;
+	while (below < expectedCount && expected[below] < scanned)
+		below++;
+
+	if (count != below || memcmp(offsets, expected, count * sizeof(uint32_t)) != 0)
+		fail(name, length, alignment, delimiter, capacity, "wrong offsets");
+}
+
+
+static uint64_t test_kernels(std::string* names)
+{
+	static const char delimiters[] = { ',', ';', '\t', ' ', '|' };
+	static const size_t capacities[] =
+	{
+		CSV_SCAN_BLOCK, CSV_SCAN_BLOCK + 1, 2 * CSV_SCAN_BLOCK - 1, 2 * CSV_SCAN_BLOCK + 7, 0
+	};
+	static const char alphabet[] = "0123456789.-+eE \t\r\n,;|";
+
+	std::vector<char> buffer(MAX_LENGTH + ALIGNMENTS);
+	std::vector<uint32_t> expected(MAX_LENGTH);
+	std::vector<uint32_t> offsets(MAX_LENGTH + CSV_SCAN_BLOCK);
+
+	struct
+	{
+		const char* name;
+		csv_scan_fn fn;
+	}
+	kernels[3];
+	size_t kernelsCount = 0;
+
+	kernels[kernelsCount].name = "csv_scan_scalar";
+	kernels[kernelsCount++].fn = csv_scan_scalar;
+
+#if defined(CSV_SCAN_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse2"))
+	{
+		kernels[kernelsCount].name = "csv_scan_sse2";
+		kernels[kernelsCount++].fn = csv_scan_sse2;
+	}
+
+	if (__builtin_cpu_supports("avx2"))
+	{
+		kernels[kernelsCount].name = "csv_scan_avx2";
+		kernels[kernelsCount++].fn = csv_scan_avx2;
+	}
+#endif
+
+	uint64_t cases = 0;
+
+	// Numeric fields, then separators nearly everywhere and everywhere
+	// to fill the index within a block
+	for (uint32_t density = 0; density < 3; density++)
+		for (size_t d = 0; d < sizeof(delimiters); d++)
+		{
+			for (size_t i = 0; i < buffer.size(); i++)
+			{
+				if (density == 0 || (density == 1 && rand() % 8 == 0))
+					buffer[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+				else
+					buffer[i] = rand() % 2 ? delimiters[d] : '\n';
+			}
+
+			for (size_t alignment = 0; alignment < ALIGNMENTS; alignment++)
+				for (size_t length = 0; length <= MAX_LENGTH; length++)
+				{
+					const char* data = &buffer[alignment];
+					const size_t expectedCount = scan_bytewise(data, length, delimiters[d], &expected[0]);
+
+					for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++)
+					{
+						// 0 - room for every byte
+						const size_t capacity = capacities[c] ? capacities[c] : length + CSV_SCAN_BLOCK;
+
+						for (size_t k = 0; k < kernelsCount; k++)
+							check_kernel(kernels[k].name, kernels[k].fn, data, length, alignment, delimiters[d],
+										 capacity, &expected[0], expectedCount, &offsets[0]);
+
+						cases++;
+					}
+				}
+		}
+
+	for (size_t k = 0; k < kernelsCount; k++)
+		*names += std::string(k ? ", " : "") + (kernels[k].name + sizeof("csv_scan_") - 1);
+
+	return cases;
+}
+
+
+//
+// Random numeric CSV, `eol` - line end, `last` - write it after the
+// last row as well. Values are printed exactly, so the reader must
+// return the same floats.
+//
+static std::string make_csv(std::vector<std::vector<float> >& rows, size_t rowsCount, size_t columns,
+							char delimiter, const char* eol, bool last)
+{
+	std::string text;
+	char field[32];
+
+	rows.assign(rowsCount, std::vector<float>(columns));
+
+	for (size_t r = 0; r < rowsCount; r++)
+	{
+		for (size_t c = 0; c < columns; c++)
+		{
+			const float value = rand() % 4 ? (float) (rand() - RAND_MAX / 2) / (1 << (rand() % 20)) : (float) (rand() % 10);
+			rows[r][c] = value;
+
+			snprintf(field, sizeof(field), "%.9g", value);
+			if (c)
+				text += delimiter;
+			text += field;
+		}
+
+		if (last || r + 1 < rowsCount)
+			text += eol;
+	}
+
+	return text;
+}
+
+
+static uint64_t test_reader()
+{
+	static const char delimiters[] = { ',', ';', '\t' };
+	static const char* eols[] = { "\n", "\r\n" };
+	static const size_t shapes[][2] =
+	{
+		{ 1, 1 }, { 1, 7 }, { 3, 1 }, { 5, 13 }, { 40, 9 }, { 20000, 24 }
+	};
+
+	uint64_t cases = 0;
+	std::vector<std::vector<float> > rows;
+
+	for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++)
+		for (size_t d = 0; d < sizeof(delimiters); d++)
+			for (size_t e = 0; e < 2; e++)
+				for (int last = 0; last < 2; last++)
+				{
+					const size_t rowsCount = shapes[s][0];
+					const size_t columns = shapes[s][1];
+					const std::string text = make_csv(rows, rowsCount, columns, delimiters[d], eols[e], last);
+
+					// The large file is checked at a few alignments only
+					const size_t alignments = rowsCount > 1000 ? 3 : ALIGNMENTS;
+
+					for (size_t alignment = 0; alignment < alignments; alignment++)
+					{
+						std::vector<char> buffer(text.size() + ALIGNMENTS);
+						memcpy(&buffer[alignment], text.data(), text.size());
+
+						MmapCsvReader reader(&buffer[alignment], text.size());
+						reader.SetDelimiterChar(delimiters[d]);
+
+						std::vector<float> values(columns + 1);
+						const char* what = NULL;
+						size_t r = 0;
+
+						for (; r < rowsCount && !what; r++)
+						{
+							if (reader.ReadLine(&values[0], values.size()) != columns)
+								what = "wrong fields count";
+							else if (memcmp(&values[0], &rows[r][0], columns * sizeof(float)) != 0)
+								what = "wrong values";
+						}
+
+						if (!what && reader.ReadLine(&values[0], values.size()) != 0)
+							what = "extra line";
+
+						if (what)
+						{
+							char name[64];
+							snprintf(name, sizeof(name), "MmapCsvReader %zux%zu%s%s row %zu", rowsCount, columns,
+									 e ? " crlf" : "", last ? "" : " no final eol", r);
+							fail(name, text.size(), alignment, delimiters[d], 0, what);
+						}
+
+						cases++;
+					}
+				}
+
+	return cases;
+}
+
+
+int main()
+{
+	srand(1);
+
+	std::string names;
+	uint64_t cases = test_kernels(&names);
+	cases += test_reader();
+
+	printf("csv_scan_test: %llu cases (%s), %u failures\n", (unsigned long long) cases, names.c_str(), failures);
+
+	return failures ? 1 : 0;
+}
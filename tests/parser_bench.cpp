@@ -0,0 +1,259 @@
+//
+// Receive path throughput: the original byte-at-a-time parser state
+// machine against the receive ring scanning frames in place, on a clean
+// answer stream and on one with random garbage between the frames.
+// Data arrives in fixed size reads, as from the port.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/parser.h"
+#include "../src/rx_ring.h"
+#include "../src/checksum.h"
+#include "../src/protocol.h"
+
+
+#define STREAM_SIZE     (16u << 20)
+#define READ_SIZE       (4096)
+#define RUNS            (5)
+
+
+// Original parser, one call per received byte
+typedef enum
+{
+	PREAMBLE_1 = 0,
+	PREAMBLE_2,
+	SIZE,
+	TYPE,
+	ERROR_CODE,
+	RESERVED_BYTES,
+	PAYLOAD
+}
+LegacyState;
+
+typedef struct
+{
+	LegacyState state;
+	uint32_t    counter;
+	uint32_t    pos;
+	uint8_t     buffer[2048];
+	uint64_t    frames;
+}
+LegacyParser;
+
+
+static void legacy_parse(LegacyParser* p, uint8_t data)
+{
+	PacketHeader* hdr = (PacketHeader*) p->buffer;
+
+	switch (p->state)
+	{
+	case PREAMBLE_1:
+		if (data == ((PREAMBLE >> 0) & 0xff))
+		{
+			p->state = PREAMBLE_2;
+			p->pos = 0;
+			p->counter = 0;
+			p->buffer[p->pos++] = data;
+		}
+		break;
+
+	case PREAMBLE_2:
+		if (data == ((PREAMBLE >> 8) & 0xff))
+		{
+			p->buffer[p->pos++] = data;
+			p->state = hdr->preamble == PREAMBLE ? SIZE : PREAMBLE_1;
+		}
+		else
+			p->state = PREAMBLE_1;
+		break;
+
+	case SIZE:
+		p->buffer[p->pos++] = data;
+		if (++p->counter >= sizeof(hdr->size))
+		{
+			p->state = (hdr->size <= sizeof(p->buffer)) &&
+					(hdr->size >= (sizeof(PacketHeader) + sizeof(uint16_t)))
+					? TYPE : PREAMBLE_1;
+		}
+		break;
+
+	case TYPE:
+		p->buffer[p->pos++] = data;
+		p->state = ERROR_CODE;
+		break;
+
+	case ERROR_CODE:
+		p->buffer[p->pos++] = data;
+		p->state = RESERVED_BYTES;
+		p->counter = sizeof(hdr->reserved);
+		break;
+
+	case RESERVED_BYTES:
+		p->buffer[p->pos++] = data;
+		if (--p->counter <= 0)
+		{
+			p->counter = hdr->size - sizeof(PacketHeader);
+			p->state = p->counter >= sizeof(uint16_t) ? PAYLOAD : PREAMBLE_1;
+		}
+		break;
+
+	case PAYLOAD:
+		p->buffer[p->pos++] = data;
+		if (--p->counter <= 0)
+		{
+			p->state = PREAMBLE_1;
+			p->pos -= sizeof(uint16_t);
+
+			uint16_t crc_packet;
+			memcpy(&crc_packet, &p->buffer[p->pos], sizeof(uint16_t));
+
+			if (crc_packet == crc16_table(p->buffer, hdr->size - sizeof(uint16_t), 0))
+				p->frames++;
+		}
+		break;
+	}
+}
+
+
+static void count_frame(void* ctx, void* data, uint32_t size)
+{
+	(void) data;
+	(void) size;
+
+	(*(uint64_t*) ctx)++;
+}
+
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+//
+// Answers to single samples and to batches of 16, `garbage` - up to
+// that many random bytes (preamble bytes included) before each frame
+//
+static uint32_t make_stream(uint8_t* stream, uint32_t garbage, uint64_t* frames)
+{
+	uint32_t size = 0;
+	*frames = 0;
+
+	for (;;)
+	{
+		const uint32_t noise = garbage ? rand() % (garbage + 1) : 0;
+		const uint32_t payload = (rand() % 4 ? 2 : 32) * sizeof(float);
+		const uint32_t total = sizeof(PacketHeader) + payload + sizeof(uint16_t);
+
+		if (size + noise + total > STREAM_SIZE)
+			return size;
+
+		for (uint32_t i = 0; i < noise; i++)
+			stream[size++] = rand() % 8 ? (uint8_t) rand() : (uint8_t) (PREAMBLE & 0xff);
+
+		PacketHeader* hdr = (PacketHeader*) (stream + size);
+		hdr->preamble = PREAMBLE;
+		hdr->size = total;
+		hdr->type = TYPE_DATASET_SAMPLE | 0x80;
+		hdr->error = ERROR_SUCCESS;
+		hdr->reserved[0] = 0;
+		hdr->reserved[1] = 0;
+
+		for (uint32_t i = 0; i < payload; i++)
+			stream[size + sizeof(PacketHeader) + i] = (uint8_t) rand();
+
+		const uint16_t crc = crc16_table(stream + size, total - sizeof(uint16_t), 0);
+		memcpy(stream + size + total - sizeof(uint16_t), &crc, sizeof(uint16_t));
+
+		size += total;
+		(*frames)++;
+	}
+}
+
+
+static void run(const char* name, const uint8_t* stream, uint32_t size, uint64_t sent)
+{
+	double legacyBest = 1e9;
+	double ringBest = 1e9;
+	uint64_t legacyFrames = 0;
+	uint64_t ringFrames = 0;
+
+	for (uint32_t r = 0; r < RUNS; r++)
+	{
+		LegacyParser* legacy = (LegacyParser*) calloc(1, sizeof(LegacyParser));
+
+		double start = now();
+		for (uint32_t i = 0; i < size; i++)
+			legacy_parse(legacy, stream[i]);
+		double elapsed = now() - start;
+
+		legacyFrames = legacy->frames;
+		legacyBest = elapsed < legacyBest ? elapsed : legacyBest;
+		free(legacy);
+
+		uint64_t frames = 0;
+		Parser parser;
+		RxRing ring;
+
+		if (0 != parser_init(&parser, count_frame, &frames) ||
+			0 != rx_ring_init(&ring, 2 * READ_SIZE + parser_buffer_size(&parser)))
+		{
+			fprintf(stderr, "Failed to init parser\n");
+			exit(1);
+		}
+
+		start = now();
+		for (uint32_t pos = 0; pos < size;)
+		{
+			uv_buf_t space = rx_ring_space(&ring);
+			uint32_t count = size - pos < READ_SIZE ? size - pos : READ_SIZE;
+			if (count > space.len)
+				count = space.len;
+
+			memcpy(space.base, stream + pos, count);
+			rx_ring_commit(&ring, &parser, count);
+			pos += count;
+		}
+		elapsed = now() - start;
+
+		ringFrames = frames;
+		ringBest = elapsed < ringBest ? elapsed : ringBest;
+
+		rx_ring_free(&ring);
+		parser_free(&parser);
+	}
+
+	printf("%-8s %6.1f MB, %8llu frames sent | byte loop %8.1f MB/s, %8llu found | ring %8.1f MB/s, %8llu found | x%.1f\n",
+		   name, size / 1e6, (unsigned long long) sent,
+		   size / legacyBest / 1e6, (unsigned long long) legacyFrames,
+		   size / ringBest / 1e6, (unsigned long long) ringFrames, legacyBest / ringBest);
+}
+
+
+int main()
+{
+	uint8_t* stream = (uint8_t*) malloc(STREAM_SIZE);
+	if (!stream)
+		return 1;
+
+	srand(1);
+
+	uint64_t frames;
+	uint32_t size = make_stream(stream, 0, &frames);
+	run("clean", stream, size, frames);
+
+	size = make_stream(stream, 64, &frames);
+	run("garbage", stream, size, frames);
+
+	size = make_stream(stream, 512, &frames);
+	run("noisy", stream, size, frames);
+
+	free(stream);
+
+	return 0;
+}